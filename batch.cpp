@@ -0,0 +1,193 @@
+#include "batch.hpp"
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <sstream>
+#include <unordered_map>
+
+#include "source.hpp"
+#include "lex.hpp"
+#include "parser.hpp"
+
+namespace fs = std::filesystem;
+
+// An empty output_dir writes each tree next to its input file
+// num_threads of 0 uses one thread per hardware thread
+BatchRunner::BatchRunner(std::string output_dir, unsigned num_threads){
+    this->output_dir = output_dir;
+    this->num_threads = num_threads;
+    this->max_nesting = Parser::DEFAULT_MAX_NESTING;
+    this->cache = nullptr;
+    if (this->num_threads == 0){
+        this->num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// Adds a file, or every file directly inside a directory. 
+// Tree files (".tree" and ".ast") in a directory are skipped, so that eg- winzig_test_programs/ can be given.
+void BatchRunner::addInput(const std::string& path){
+    if (!fs::is_directory(path)){
+        input_paths.push_back(path);
+        return;
+    }
+    std::vector<std::string> found = { };
+    for (const fs::directory_entry& entry: fs::directory_iterator(path)){
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && extension != ".tree" && extension != ".ast"){
+            found.push_back(entry.path().string());
+        }
+    }
+    // Directory order is unspecified, so sort for a deterministic report
+    std::sort(found.begin(), found.end());
+    input_paths.insert(input_paths.end(), found.begin(), found.end());
+}
+
+void BatchRunner::setMaxNesting(int max_nesting){
+    this->max_nesting = max_nesting;
+}
+
+// Reuses the trees of unchanged files from the cache, and adds the rest to it. 
+// The cache can be shared with other processes
+void BatchRunner::setCache(ParseCache* cache){
+    this->cache = cache;
+}
+
+std::string BatchRunner::outputPathFor(const std::string& input_path){
+    if (output_dir.empty()){
+        return input_path + ".ast";
+    }
+    return (fs::path(output_dir) / fs::path(input_path).filename()).string() + ".ast";
+}
+
+// Parses a single file and writes its tree to output_path
+void BatchRunner::parseFile(const std::string& input_path, const std::string& output_path){
+    SourceFile source (input_path);
+
+    std::string cache_key = "";
+    if (cache){
+        // Keyed by the nesting limit too, as a tree within one limit may exceed another
+        cache_key = ParseCache::keyFor(source.getContent(), "ast-depth" + std::to_string(max_nesting));
+        std::unique_ptr<SourceFile> cached = cache->load(cache_key);
+        if (cached){
+            writeOutput(output_path, cached->getContent());
+            return;
+        }
+    }
+
+    Lexer lexer (source.getContent());
+    TreeArena arena;
+    Parser parser = Parser(lexer, arena);
+    parser.setMaxNesting(max_nesting);
+
+    parser.parseWinzig();
+
+    if (!parser.getDiagnostics().empty()){
+        std::string message = "";
+        for (const Diagnostic& d: parser.getDiagnostics()){
+            message += "\n    " + std::to_string(d.location.line) + ":" + std::to_string(d.location.column) + ": " + d.message;
+        }
+        throw std::runtime_error(std::to_string(parser.getDiagnostics().size()) + " syntax error(s)" + message);
+    }
+
+    if (cache){
+        // Printed once, for both the output and the cache
+        std::ostringstream tree;
+        parser.returnFinalTree()->pprintTree(tree);
+        tree << "\n";
+        std::string text = tree.str();
+        writeOutput(output_path, text);
+        cache->store(cache_key, text);
+        return;
+    }
+
+    std::ofstream output_file (output_path);
+    if (!output_file){
+        throw std::runtime_error("Could not write file " + output_path);
+    }
+    parser.returnFinalTree()->pprintTree(output_file);
+    output_file << "\n";
+}
+
+void BatchRunner::writeOutput(const std::string& output_path, std::string_view text){
+    std::ofstream output_file (output_path, std::ios::binary);
+    if (!output_file){
+        throw std::runtime_error("Could not write file " + output_path);
+    }
+    output_file.write(text.data(), text.size());
+}
+
+// Parses every input, with each worker taking the next unclaimed file until none are left.
+// Prints one line per input in the order they were added, and returns the exit code.
+int BatchRunner::run(){
+    errors.assign(input_paths.size(), "");
+    std::atomic<size_t> next_input (0);
+
+    if (!output_dir.empty()){
+        fs::create_directories(output_dir);
+    }
+
+    // Inputs with the same file name in different directories would all be written to the same
+    // file in output_dir. Only the first is parsed, and the rest fail instead of overwriting it.
+    // Paths are compared once canonical, so that the same file named in two ways is caught too
+    std::vector<std::string> output_paths (input_paths.size());
+    std::unordered_map<std::string, size_t> writers = { };
+    for (size_t i=0; i<input_paths.size(); ++i){
+        output_paths[i] = outputPathFor(input_paths[i]);
+        auto [it, inserted] = writers.emplace(fs::weakly_canonical(output_paths[i]).string(), i);
+        if (!inserted){
+            errors[i] = "Output " + output_paths[i] + " would overwrite that of " + input_paths[it->second];
+        }
+    }
+
+    auto worker = [&](){
+        size_t i;
+        while ((i = next_input++) < input_paths.size()){
+            if (!errors[i].empty()){
+                continue;
+            }
+            try{
+                parseFile(input_paths[i], output_paths[i]);
+            }
+            catch (const std::exception& err){
+                errors[i] = err.what();
+                if (errors[i].empty()){
+                    errors[i] = "Unknown error";
+                }
+            }
+        }
+    };
+
+    unsigned n = std::min<size_t>(num_threads, input_paths.size());
+    std::vector<std::thread> threads = { };
+    for (unsigned t=1; t<n; ++t){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t: threads){
+        t.join();
+    }
+    if (cache && cache->getNumStored() > 0){
+        cache->evict();
+    }
+
+    int failed = 0;
+    for (size_t i=0; i<input_paths.size(); ++i){
+        if (errors[i].empty()){
+            std::cout << input_paths[i] << ": ok\n";
+        }
+        else {
+            // Lexer errors end with a newline of their own
+            std::string message = errors[i];
+            while (!message.empty() && (message.back() == '\n' || message.back() == ' ')){
+                message.pop_back();
+            }
+            std::cout << input_paths[i] << ": " << message << "\n";
+            failed++;
+        }
+    }
+    return failed ? 1 : 0;
+}
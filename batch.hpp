@@ -0,0 +1,35 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cache.hpp"
+
+// Parses many WinZigC files in one process, on a pool of worker threads.
+// Each file gets its own Lexer, Parser and TreeArena, so files are independent of each other 
+// and an error in one file does not affect the rest.
+class BatchRunner {
+
+    private:
+        std::vector<std::string> input_paths;
+        std::vector<std::string> errors;
+        std::string output_dir;
+        unsigned num_threads;
+        int max_nesting;
+        ParseCache* cache;
+
+        std::string outputPathFor(const std::string& input_path);
+        void parseFile(const std::string& input_path, const std::string& output_path);
+        void writeOutput(const std::string& output_path, std::string_view text);
+
+    public:
+        BatchRunner(std::string output_dir, unsigned num_threads);
+
+        void addInput(const std::string& path);
+        void setMaxNesting(int max_nesting);
+        void setCache(ParseCache* cache);
+        int run();
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <sys/resource.h>
+
+#include "lex.hpp"
+#include "chunklexer.hpp"
+#include "scan.hpp"
+#include "token.hpp"
+#include "parser.hpp"
+#include "incremental.hpp"
+#include "semantic.hpp"
+#include "typecheck.hpp"
+
+// Benchmarks each phase of the pipeline on a synthetic WinZigC program.
+// Usage: winzigc_bench [--functions N] [--statements N] [--depth N] [--cases N] [--decls N]
+//                      [--comments N] [--threads N] [--repeat N] [--write FILE]
+
+// Shape of the generated program
+struct ProgramShape {
+    int functions = 200;    // Number of functions in subprogs
+    int statements = 20;    // Assignments per function body
+    int depth = 8;          // Nesting depth of each assigned expression
+    int cases = 20;         // Case clauses per function
+    int decls = 50;         // Entries in each of the global const, type and var sections
+    int comments = 0;       // Lines in a block comment before each function
+};
+
+// Builds an integer expression nested to the given depth, cycling through the operator levels.
+// A comparison is turned back into an integer by ord, so that the program type checks
+std::string generateExpression(int depth, int seed){
+    if (depth == 0){
+        return (seed % 2) ? "x" : std::to_string(seed % 97);
+    }
+    static const char* operators[] = { "+", "*", "-", "mod", "/" };
+    std::string inner = generateExpression(depth-1, seed+1);
+
+    switch (depth % 4){
+        case 0:
+            return "-(" + inner + ")";
+        case 1:
+            return "(" + inner + " " + operators[seed % 5] + " " + std::to_string(depth) + ")";
+        case 2:
+            return "succ(" + inner + ")";
+        default:
+            return "ord(" + inner + " <= y)";
+    }
+}
+
+std::string generateProgram(const ProgramShape& shape){
+    std::string program = "{ Synthetic benchmark program }\nprogram bench:\n";
+
+    if (shape.decls > 0){
+        program += "const\n";
+        for (int i=0; i<shape.decls; ++i){
+            program += "    c" + std::to_string(i) + " = " + std::to_string(i) + (i+1<shape.decls ? ",\n" : ";\n");
+        }
+        program += "type\n";
+        for (int i=0; i<shape.decls; ++i){
+            program += "    t" + std::to_string(i) + " = (a" + std::to_string(i) + ", b" + std::to_string(i) +
+                       ", c" + std::to_string(i) + "x);\n";
+        }
+        program += "var\n";
+        for (int i=0; i<shape.decls; ++i){
+            program += "    v" + std::to_string(i) + ", w" + std::to_string(i) + " : integer;\n";
+        }
+    }
+
+    for (int f=0; f<shape.functions; ++f){
+        std::string name = "f" + std::to_string(f);
+        if (shape.comments > 0){
+            program += "\n{";
+            for (int c=0; c<shape.comments; ++c){
+                program += "\n    Line " + std::to_string(c) + " of the description of " + name + ", with its arguments and result";
+            }
+            program += "\n}";
+        }
+        program += "\nfunction " + name + " (x : integer; y : integer) : integer;\n";
+        program += "var\n    z : integer;\nbegin\n";
+        for (int s=0; s<shape.statements; ++s){
+            program += "    z := " + generateExpression(shape.depth, f+s) + ";\n";
+        }
+        if (shape.cases > 0){
+            program += "    case x of\n";
+            for (int c=0; c<shape.cases; ++c){
+                program += "        " + std::to_string(2*c) + ".." + std::to_string(2*c+1) +
+                           ": z := z + " + std::to_string(c) + ";\n";
+            }
+            program += "        otherwise z := 0\n    end;\n";
+        }
+        program += "    # Loop and branch over the result\n";
+        program += "    while z > 0 do z := z - 1;\n";
+        program += "    if z = 0 then output(z) else output(z, x);\n";
+        program += "    return z\nend " + name + ";\n";
+    }
+
+    program += "\nbegin\n    read(v0);\n";
+    for (int f=0; f<shape.functions; ++f){
+        program += "    w0 := f" + std::to_string(f) + "(v0, " + std::to_string(f) + ");\n";
+    }
+    program += "    output(w0)\nend bench.\n";
+    return program;
+}
+
+// Stream buffer which discards output, counting the bytes written
+class CountingBuffer : public std::streambuf {
+    public:
+        size_t count = 0;
+    protected:
+        int overflow(int c) override {
+            count++;
+            return c;
+        }
+        std::streamsize xsputn(const char*, std::streamsize n) override {
+            count += n;
+            return n;
+        }
+};
+
+// Runs the function the given number of times, and returns the fastest time in seconds.
+// The setup, if any, is run untimed before each run
+double timeBest(int repeat, const std::function<void()>& fn, const std::function<void()>& setup = nullptr){
+    double best = 0;
+    for (int i=0; i<repeat; ++i){
+        if (setup){
+            setup();
+        }
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best){
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+void report(const std::string& phase, double seconds, double megabytes, double items, const std::string& unit){
+    std::cout << phase << ": " << seconds*1000 << " ms, "
+              << megabytes/seconds << " MB/s, "
+              << items/seconds << " " << unit << "/s\n";
+}
+
+int main(int argc, char *argv[]){
+    ProgramShape shape;
+    int repeat = 5;
+    unsigned num_threads = 0;
+    std::string write_path = "";
+
+    for (int i=1; i<argc; ++i){
+        std::string arg = argv[i];
+        if (i+1 >= argc){
+            std::cout << "Error: Missing value for " << arg << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--functions")       shape.functions = std::stoi(value);
+        else if (arg == "--statements") shape.statements = std::stoi(value);
+        else if (arg == "--depth")      shape.depth = std::stoi(value);
+        else if (arg == "--cases")      shape.cases = std::stoi(value);
+        else if (arg == "--decls")      shape.decls = std::stoi(value);
+        else if (arg == "--comments")   shape.comments = std::stoi(value);
+        else if (arg == "--threads")    num_threads = std::stoul(value);
+        else if (arg == "--repeat")     repeat = std::stoi(value);
+        else if (arg == "--write")      write_path = value;
+        else {
+            std::cout << "Error: Unknown argument " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::string content = generateProgram(shape);
+    if (!write_path.empty()){
+        std::ofstream(write_path) << content;
+    }
+    double megabytes = content.size() / 1e6;
+    std::cout << "Program: " << megabytes << " MB, " << shape.functions << " functions\n";
+    std::cout << "Scanning with " << Scan::implementation() << " kernels\n";
+
+    try{
+        // Lexing the whole content into a token sequence
+        size_t num_tokens = 0;
+        double lex_time = timeBest(repeat, [&](){
+            Lexer lexer (content);
+            lexer.parse();
+            num_tokens = lexer.getTokenSequence().size();
+        });
+        report("Lexer::parse", lex_time, megabytes, num_tokens, "tokens");
+
+        // The same, split into chunks lexed on several threads
+        ChunkedLexer chunked (content, num_threads);
+        double chunked_time = timeBest(repeat, [&](){
+            chunked.parse();
+        });
+        report("ChunkedLexer::parse", chunked_time, megabytes, chunked.getTokenSequence().size(), "tokens");
+        std::cout << "    " << chunked.getNumChunks() << " chunks, " << chunked.getDiscardedTokens()
+                  << " speculative tokens discarded\n";
+
+        // Parsing, which pulls its tokens from the lexer as it goes
+        size_t num_nodes = 0;
+        double parse_time = timeBest(repeat, [&](){
+            Lexer lexer (content);
+            TreeArena arena;
+            Parser parser = Parser(lexer, arena);
+            parser.parseWinzig();
+            num_nodes = arena.getNodeCount();
+        });
+        report("Parser::parseWinzig (with lexing)", parse_time, megabytes, num_nodes, "nodes");
+
+        // Resolving the names of a flat tree built once up front
+        {
+            Lexer lexer (content);
+            FlatTree flat;
+            Parser parser = Parser(lexer, flat);
+            parser.parseWinzig();
+            FlatTree& tree = parser.returnFinalFlatTree();
+
+            size_t num_errors = 0;
+            double check_time = timeBest(repeat, [&](){
+                SemanticAnalyzer analyzer (tree, lexer, 1);
+                analyzer.analyze();
+                num_errors = analyzer.getDiagnostics().size();
+            });
+            report("SemanticAnalyzer::analyze (1 thread)", check_time, megabytes, tree.size(), "nodes");
+
+            // The same, with the functions analyzed on several threads
+            double parallel_check_time = timeBest(repeat, [&](){
+                SemanticAnalyzer analyzer (tree, lexer, num_threads);
+                analyzer.analyze();
+            });
+            report("SemanticAnalyzer::analyze (parallel)", parallel_check_time, megabytes, tree.size(), "nodes");
+
+            // Typing the same tree, whose names were resolved once up front
+            SemanticAnalyzer analyzer (tree, lexer, num_threads);
+            analyzer.analyze();
+            size_t num_type_errors = 0;
+            double type_time = timeBest(repeat, [&](){
+                TypeChecker checker (tree, lexer, analyzer);
+                checker.check();
+                num_type_errors = checker.getDiagnostics().size();
+            });
+            report("TypeChecker::check", type_time, megabytes, tree.size(), "nodes");
+            num_errors += num_type_errors;
+            if (num_errors > 0){
+                std::cout << "    " << num_errors << " errors in the generated program\n";
+            }
+        }
+
+        // Printing a tree built once up front
+        Lexer lexer (content);
+        TreeArena arena;
+        Parser parser = Parser(lexer, arena);
+        parser.parseWinzig();
+        TreeNode* ast = parser.returnFinalTree();
+
+        CountingBuffer sink;
+        double print_time = timeBest(repeat, [&](){
+            std::ostream out (&sink);
+            ast->pprintTree(out);
+        });
+        report("TreeNode::pprintTree", print_time, sink.count / 1e6 / repeat, num_nodes, "nodes");
+
+        // Editing an assignment in the middle function, as an editor would on a keystroke
+        if (shape.functions > 0 && shape.statements > 0){
+            std::string middle = "function f" + std::to_string(shape.functions / 2) + " ";
+            uint32_t offset = content.find(":= ", content.find(middle)) + 3;
+
+            // Each edit is made to a fresh parse, as one made after MAX_GENERATIONS others reparses everything
+            IncrementalParser incremental;
+            int incremental_edits = 0;
+            double edit_time = timeBest(repeat, [&](){
+                incremental.applyEdit(TextEdit{offset, 0, "1 + "});
+                incremental_edits += incremental.wasIncremental();
+            }, [&](){
+                incremental.parse(content);
+            });
+            report("IncrementalParser::applyEdit", edit_time, megabytes, num_nodes, "nodes");
+            std::cout << "    " << incremental_edits << " of " << repeat << " edits reparsed one function, reusing "
+                      << incremental.getReusedFunctions() << " functions\n";
+        }
+    }
+    catch (const std::runtime_error& err){
+        std::cout << err.what() << "\n";
+        return 1;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "Peak memory: " << usage.ru_maxrss / 1024.0 << " MB\n";
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "binarytree.hpp"
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+
+// Maps the file at the path, which must stay unchanged while the tree is in use
+BinaryTree::BinaryTree(const std::string& path){
+    this->file = std::make_unique<SourceFile>(path);
+    open(file->getContent());
+}
+
+// Views a tree already in memory, which must outlive the BinaryTree and be 4-byte aligned
+BinaryTree::BinaryTree(std::string_view data){
+    open(data);
+}
+
+// Checks the header and that the sections fit the data exactly. The nodes themselves are only
+// checked as they are accessed, so that opening a file does not touch all of it
+void BinaryTree::open(std::string_view data){
+    this->data = data;
+
+    if (data.size() < sizeof(BinaryHeader) || reinterpret_cast<uintptr_t>(data.data()) % alignof(BinaryNode) != 0){
+        throw std::runtime_error("Error: Not a binary tree file. ");
+    }
+    this->header = reinterpret_cast<const BinaryHeader*>(data.data());
+    if (memcmp(header->magic, "WZBT", 4) != 0){
+        throw std::runtime_error("Error: Not a binary tree file. ");
+    }
+    if (header->version != VERSION){
+        throw std::runtime_error("Error: Binary tree file has version " + std::to_string(header->version) +
+                                 ", expected " + std::to_string(VERSION) + ". ");
+    }
+
+    uint64_t nodes_size = (uint64_t) header->num_nodes * sizeof(BinaryNode);
+    uint64_t offsets_size = ((uint64_t) header->num_strings + 1) * sizeof(uint32_t);
+    if (sizeof(BinaryHeader) + nodes_size + offsets_size + header->string_bytes != data.size()){
+        throw std::runtime_error("Error: Binary tree file is truncated or corrupt. ");
+    }
+    this->nodes = reinterpret_cast<const BinaryNode*>(data.data() + sizeof(BinaryHeader));
+    this->string_offsets = reinterpret_cast<const uint32_t*>(data.data() + sizeof(BinaryHeader) + nodes_size);
+    this->strings = data.data() + sizeof(BinaryHeader) + nodes_size + offsets_size;
+}
+
+static_assert(FlatNode::NO_VALUE == BinaryNode::NO_VALUE, "Values are copied from FlatNode as they are");
+
+// Writes a finished flat tree in the binary form. The string table is the tree's symbol table,
+// so each distinct token value is stored once and a value's index is its symbol
+void BinaryTree::write(const FlatTree& tree, std::ostream& out){
+    if (!tree.isFinished()){
+        throw std::runtime_error("Cannot write a flat tree which is not finished");
+    }
+    std::vector<BinaryNode> nodes = { };
+    nodes.reserve(tree.size());
+    for (uint32_t i=0; i<tree.size(); ++i){
+        const FlatNode& node = tree.getNode(i);
+        nodes.push_back(BinaryNode{static_cast<uint32_t>(node.type), node.num_children, node.value, node.end});
+    }
+
+    const Interner& symbols = tree.getSymbols();
+    std::vector<uint32_t> string_offsets = { 0 };
+    std::string strings = "";
+    for (uint32_t symbol=0; symbol<symbols.size(); ++symbol){
+        strings.append(symbols.getName(symbol));
+        string_offsets.push_back(strings.size());
+    }
+
+    BinaryHeader header = {
+        {'W', 'Z', 'B', 'T'}, VERSION, (uint32_t) nodes.size(), (uint32_t) string_offsets.size() - 1,
+        (uint32_t) strings.size(), 0
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(BinaryNode));
+    out.write(reinterpret_cast<const char*>(string_offsets.data()), string_offsets.size() * sizeof(uint32_t));
+    out.write(strings.data(), strings.size());
+}
+
+uint32_t BinaryTree::size() const {
+    return header->num_nodes;
+}
+
+const BinaryNode& BinaryTree::getNode(uint32_t index) const {
+    return nodes[index];
+}
+
+TreeNodeType BinaryTree::getType(uint32_t index) const {
+    if (nodes[index].type >= NUM_TREE_NODE_TYPES){
+        throw std::runtime_error("Error: Binary tree file is truncated or corrupt. ");
+    }
+    return static_cast<TreeNodeType>(nodes[index].type);
+}
+
+// Returns the token value for value leaves, and the type label for all other nodes
+std::string_view BinaryTree::getLabel(uint32_t index) const {
+    uint32_t value = nodes[index].value;
+    if (value == BinaryNode::NO_VALUE){
+        return TreeNode::typeString(getType(index));
+    }
+    if (value >= header->num_strings || string_offsets[value] > string_offsets[value+1]
+        || string_offsets[value+1] > header->string_bytes){
+        throw std::runtime_error("Error: Binary tree file is truncated or corrupt. ");
+    }
+    return std::string_view(strings + string_offsets[value], string_offsets[value+1] - string_offsets[value]);
+}
+
+// Writes the tree in the same format as TreeNode::pprintTree, in a single pass over the nodes
+void BinaryTree::pprintTree(std::ostream& out) const {
+    // Ends of the subtrees enclosing the current node, the innermost on top
+    std::vector<uint32_t> enclosing = { };
+    std::string indent = "";
+
+    for (uint32_t i=0; i<size(); ++i){
+        while (!enclosing.empty() && enclosing.back() <= i){
+            enclosing.pop_back();
+        }
+        while (indent.size() < 2*enclosing.size()){
+            indent.append(". ");
+        }
+        if (i > 0){
+            out << "\n";
+        }
+        out.write(indent.data(), 2*enclosing.size());
+        out << getLabel(i) << "(" << nodes[i].num_children << ")";
+
+        enclosing.push_back(nodes[i].end);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef BINARYTREE_H
+#define BINARYTREE_H
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <memory>
+#include <cstdint>
+#include "treenode.hpp"
+#include "flattree.hpp"
+#include "source.hpp"
+
+// Binary form of a tree, written by --emit=bin. All fields are 32-bit, in the byte order of the machine
+// which wrote them, as the file is walked in place; one of the other byte order fails the version check.
+// It is laid out as
+//   BinaryHeader
+//   BinaryNode[num_nodes]         the nodes in pre-order, as in a FlatTree
+//   uint32_t[num_strings + 1]     offset of each string in the string data, and the end of the last one
+//   char[string_bytes]            the string data
+// Token values are stored once each in the string table, however many leaves share them.
+struct BinaryHeader {
+    char magic[4];              // "WZBT"
+    uint32_t version;
+    uint32_t num_nodes;
+    uint32_t num_strings;
+    uint32_t string_bytes;
+    uint32_t reserved;          // Zero, keeping the node array 8-byte aligned
+};
+
+struct BinaryNode {
+    uint32_t type;              // TreeNodeType
+    uint32_t num_children;
+    uint32_t value;             // Index into the string table for token value leaves, NO_VALUE for others
+    uint32_t end;               // Index one past the last node of this subtree
+
+    static const uint32_t NO_VALUE = UINT32_MAX;
+};
+
+// Read-only view of a tree in the binary form, which is walked in place rather than deserialized.
+// Opened from a path, the file is memory mapped, so loading costs no more than checking the header.
+class BinaryTree {
+
+    private:
+        std::unique_ptr<SourceFile> file;
+        std::string_view data;
+
+        const BinaryHeader* header;
+        const BinaryNode* nodes;
+        const uint32_t* string_offsets;
+        const char* strings;
+
+        void open(std::string_view data);
+
+    public:
+        // Bumped whenever the layout changes. Files of other versions are rejected
+        static const uint32_t VERSION = 1;
+
+        BinaryTree(const std::string& path);
+        BinaryTree(std::string_view data);
+
+        BinaryTree(const BinaryTree&) = delete;
+        BinaryTree& operator=(const BinaryTree&) = delete;
+
+        static void write(const FlatTree& tree, std::ostream& out);
+
+        uint32_t size() const;
+        const BinaryNode& getNode(uint32_t index) const;
+        TreeNodeType getType(uint32_t index) const;
+        std::string_view getLabel(uint32_t index) const;
+
+        void pprintTree(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "cache.hpp"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <cstdio>
+#include <chrono>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "parser.hpp"
+
+namespace fs = std::filesystem;
+
+// The directory is created if it does not exist yet
+ParseCache::ParseCache(std::string dir, uint64_t max_bytes){
+    this->dir = dir;
+    this->max_bytes = max_bytes;
+    this->num_stored = 0;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+}
+
+// Returns the key of the entry for the content, printed in the given format.
+// The key is a 64-bit FNV-1a hash of the parser version, format and content, followed by the content size
+std::string ParseCache::keyFor(std::string_view content, std::string_view format){
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](std::string_view bytes){
+        for (unsigned char c: bytes){
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        // Separates the fields, so that moving bytes from one to the next changes the hash
+        hash = (hash ^ 0xff) * 1099511628211ull;
+    };
+    mix(std::to_string(Parser::VERSION));
+    mix(format);
+    mix(content);
+
+    char key[64];
+    snprintf(key, sizeof(key), "%016llx-%llx", (unsigned long long) hash, (unsigned long long) content.size());
+    return key;
+}
+
+std::string ParseCache::pathFor(const std::string& key){
+    return (fs::path(dir) / (key + ".cache")).string();
+}
+
+// A hit also marks the entry as the most recently used, by updating its modification time
+std::unique_ptr<SourceFile> ParseCache::load(const std::string& key){
+    std::string path = pathFor(key);
+    std::unique_ptr<SourceFile> entry;
+    try {
+        entry = std::make_unique<SourceFile>(path);
+    }
+    catch (const std::runtime_error& err){
+        return nullptr;
+    }
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return entry;
+}
+
+// Writes the entry to a temporary file of its own, then renames it over the entry in one step
+void ParseCache::store(const std::string& key, std::string_view data){
+    std::string path = pathFor(key);
+    std::string temp_path = path + "." + std::to_string(getpid()) + "." + std::to_string(num_stored++) + ".tmp";
+
+    std::ofstream temp_file (temp_path, std::ios::binary);
+    temp_file.write(data.data(), data.size());
+    temp_file.close();
+
+    std::error_code ec;
+    if (!temp_file){
+        fs::remove(temp_path, ec);
+        return;
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec){
+        fs::remove(temp_path, ec);
+    }
+}
+
+// Removes the least recently used entries until the rest fit in the size limit.
+// Lists the whole directory, so it is meant to be called once per run rather than after every store
+void ParseCache::evict(){
+    struct Entry {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type last_used;
+    };
+    std::vector<Entry> entries = { };
+    uint64_t total = 0;
+
+    // Temporary files this old were left behind by a run which did not finish
+    fs::file_time_type stale = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+    std::error_code ec;
+    for (fs::directory_iterator it (dir, ec), end; !ec && it != end; it.increment(ec)){
+        std::error_code entry_ec;
+        if (it->path().extension() == ".tmp" && it->last_write_time(entry_ec) < stale && !entry_ec){
+            fs::remove(it->path(), entry_ec);
+            continue;
+        }
+        if (it->path().extension() != ".cache"){
+            continue;
+        }
+        uint64_t size = it->file_size(entry_ec);
+        fs::file_time_type last_used = it->last_write_time(entry_ec);
+        if (!entry_ec){
+            entries.push_back(Entry{it->path(), size, last_used});
+            total += size;
+        }
+    }
+    if (total <= max_bytes){
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+        return a.last_used < b.last_used;
+    });
+    for (const Entry& entry: entries){
+        if (total <= max_bytes){
+            break;
+        }
+        // Another process may have removed it already, in which case its space is gone all the same
+        fs::remove(entry.path, ec);
+        total -= entry.size;
+    }
+}
+
+uint64_t ParseCache::getNumStored(){
+    return num_stored;
+}
@@ -0,0 +1,44 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "source.hpp"
+
+// On-disk cache of the trees printed for source files, which can be shared between runs
+// and between the workers of a batch (in one process or several).
+// Entries are keyed by a hash of the source content together with Parser::VERSION and the output format,
+// so an edited file or a changed parser simply misses.
+// Each entry is written to a temporary file and renamed into place, so a partial entry is never read.
+// Once the entries exceed the size limit, the least recently used ones are removed by evict().
+// The cache is best effort - failing to read or write an entry is treated as a miss, never as an error.
+class ParseCache {
+
+    private:
+        std::string dir;
+        uint64_t max_bytes;
+
+        // Number of entries this process has tried to store, which also makes temporary file names unique
+        std::atomic<uint64_t> num_stored;
+
+        std::string pathFor(const std::string& key);
+
+    public:
+        static const uint64_t DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+        ParseCache(std::string dir, uint64_t max_bytes);
+
+        static std::string keyFor(std::string_view content, std::string_view format);
+
+        // Returns the entry mapped into memory, or nullptr on a miss
+        std::unique_ptr<SourceFile> load(const std::string& key);
+        void store(const std::string& key, std::string_view data);
+        void evict();
+
+        uint64_t getNumStored();
+};
+
+#endif
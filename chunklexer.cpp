@@ -0,0 +1,172 @@
+#include "chunklexer.hpp"
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "lex.hpp"
+#include "scan.hpp"
+
+ChunkedLexer::ChunkedLexer(std::string_view content, unsigned num_threads){
+    this->content = content;
+    this->num_threads = num_threads;
+    this->min_chunk_size = DEFAULT_MIN_CHUNK_SIZE;
+    this->num_chunks = 0;
+    this->discarded_tokens = 0;
+    tokens = { };
+    if (this->num_threads == 0){
+        this->num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// Lowering this splits even small contents, which is mostly useful for testing reconciliation
+void ChunkedLexer::setMinChunkSize(size_t min_chunk_size){
+    this->min_chunk_size = std::max<size_t>(1, min_chunk_size);
+}
+
+// Returns the offset at which a token starts. Strings are the one token whose value
+// does not start there, as it leaves out the opening quote
+uint32_t ChunkedLexer::startOf(const Token& token){
+    uint32_t offset = token.getValue().data() - content.data();
+    return token.getType() == TokenType::STRING ? offset - 1 : offset;
+}
+
+// Returns the first non-whitespace character of the first line starting at or after the offset,
+// or the end of the content if there is none
+uint32_t ChunkedLexer::nextLineStart(uint32_t offset){
+    if (offset > 0 && offset < content.size() && content[offset-1] != '\n'){
+        const char* newline = (const char*) memchr(content.data() + offset, '\n', content.size() - offset);
+        offset = newline ? newline - content.data() + 1 : content.size();
+    }
+    offset = std::min<size_t>(offset, content.size());
+    return offset + Scan::whitespaceRun(content.data() + offset, content.size() - offset);
+}
+
+// Speculatively lexes the tokens starting in the chunk. Only the first chunk is known to
+// start at a token, so the others start at the next line, and any of them which meets an error
+// starts again on the line after it
+void ChunkedLexer::lexChunk(Chunk& chunk, bool first){
+    Lexer lexer (content);
+    uint32_t position = first ? chunk.begin : nextLineStart(chunk.begin);
+
+    while (position < chunk.end){
+        lexer.seek(position);
+        try{
+            while (lexer.positionValid() && lexer.getPosition() < chunk.end){
+                position = lexer.getPosition();
+                chunk.tokens.push_back(lexer.scanToken());
+            }
+            chunk.segments.push_back(Segment{chunk.tokens.size(), lexer.getPosition()});
+            return;
+        }
+        catch (const std::runtime_error&){
+            // The token at position could not be lexed, so the segment must resume there
+            chunk.segments.push_back(Segment{chunk.tokens.size(), position});
+            position = nextLineStart(position + 1);
+        }
+    }
+}
+
+// Follows the true token stream through the chunk, from the position of its first token
+// (the position after the previous chunk's last token). Returns the position after the
+// chunk's last token, and throws if the true stream meets an error
+uint32_t ChunkedLexer::reconcile(Chunk& chunk, uint32_t position){
+    Lexer lexer (content);
+    size_t j = 0;
+    size_t used = 0;
+
+    while (position < chunk.end && position < content.size()){
+        while (j < chunk.tokens.size() && startOf(chunk.tokens[j]) < position){
+            j++;
+        }
+        if (j < chunk.tokens.size() && startOf(chunk.tokens[j]) == position){
+            // In step with the speculation, whose tokens are right up to the end of the segment
+            auto segment = std::upper_bound(chunk.segments.begin(), chunk.segments.end(), j,
+                [](size_t index, const Segment& s){ return index < s.end; });
+            chunk.pieces.push_back(Piece{false, j, segment->end - j});
+            used += segment->end - j;
+            position = segment->resume_offset;
+            j = segment->end;
+        }
+        else {
+            lexer.seek(position);
+            Token token = lexer.scanToken();
+            if (chunk.pieces.empty() || !chunk.pieces.back().relexed){
+                chunk.pieces.push_back(Piece{true, chunk.relexed.size(), 0});
+            }
+            chunk.relexed.push_back(token);
+            chunk.pieces.back().count++;
+            position = lexer.getPosition();
+        }
+    }
+
+    chunk.num_tokens = 0;
+    for (const Piece& piece: chunk.pieces){
+        chunk.num_tokens += piece.count;
+    }
+    discarded_tokens += chunk.tokens.size() - used;
+    return position;
+}
+
+// Tokenizes the whole content (including comments) into the token sequence, as Lexer::parse does
+void ChunkedLexer::parse(){
+    tokens.clear();
+    discarded_tokens = 0;
+
+    size_t size = content.size();
+    num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, size / min_chunk_size));
+    std::vector<Chunk> chunks (num_chunks);
+    for (size_t i=0; i<num_chunks; ++i){
+        chunks[i].begin = i * size / num_chunks;
+        chunks[i].end = (i+1) * size / num_chunks;
+    }
+
+    // Runs the work for each chunk on its own thread, the first on this one
+    auto forEachChunk = [&](auto work){
+        std::vector<std::thread> threads = { };
+        for (size_t i=1; i<num_chunks; ++i){
+            threads.emplace_back(work, i);
+        }
+        work(0);
+        for (std::thread& t: threads){
+            t.join();
+        }
+    };
+
+    forEachChunk([&](size_t i){
+        lexChunk(chunks[i], i == 0);
+    });
+
+    uint32_t position = 0;
+    std::vector<size_t> offsets (num_chunks);
+    size_t num_tokens = 0;
+    for (size_t i=0; i<num_chunks; ++i){
+        position = reconcile(chunks[i], position);
+        offsets[i] = num_tokens;
+        num_tokens += chunks[i].num_tokens;
+    }
+
+    // Concatenating is about as much work as lexing, so it is shared out too
+    tokens.assign(num_tokens, Token(TokenType::IDENTIFER, std::string_view()));
+    forEachChunk([&](size_t i){
+        auto out = tokens.begin() + offsets[i];
+        for (const Piece& piece: chunks[i].pieces){
+            const std::vector<Token>& from = piece.relexed ? chunks[i].relexed : chunks[i].tokens;
+            out = std::copy_n(from.begin() + piece.begin, piece.count, out);
+        }
+    });
+}
+
+const std::vector<Token>& ChunkedLexer::getTokenSequence(){
+    return tokens;
+}
+
+// Number of chunks the last parse was split into
+size_t ChunkedLexer::getNumChunks(){
+    return num_chunks;
+}
+
+// Number of tokens the last parse found by speculation and then threw away, as a measure of wasted work
+size_t ChunkedLexer::getDiscardedTokens(){
+    return discarded_tokens;
+}
@@ -0,0 +1,77 @@
+#ifndef CHUNKLEXER_H
+#define CHUNKLEXER_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "token.hpp"
+
+// Tokenizes a large content on several threads, producing exactly the token sequence (comments
+// included) of Lexer::parse, and throwing the same error for invalid content.
+// The content is split into chunks, one per thread. Each chunk but the first starts at a guess:
+// the first token of the line after its boundary, which is wrong when the boundary falls inside
+// a multiline comment or string. Every chunk is lexed from its guess at the same time. Then the
+// chunks are reconciled in order: the true token stream (known at the start of the content) is
+// followed into each chunk, relexing token by token until it reaches the start of a token the chunk
+// also found. The Lexer keeps no state but its position, so from there the two streams are the same.
+// A guess which goes wrong (an error, eg- at the '}' ending a comment) is retried on the next line,
+// so a bad guess usually costs a few relexed lines rather than the whole chunk.
+class ChunkedLexer {
+
+    private:
+        std::string_view content;
+        std::vector<Token> tokens;
+        unsigned num_threads;
+        size_t min_chunk_size;
+        size_t num_chunks;
+
+        // Tokens of a run of speculative lexing which ended at resume_offset,
+        // either at the end of the chunk or at an error
+        struct Segment {
+            size_t end;
+            uint32_t resume_offset;
+        };
+
+        // Tokens of the final sequence taken from a chunk, either from its speculative
+        // tokens or from those relexed while reconciling it
+        struct Piece {
+            bool relexed;
+            size_t begin;
+            size_t count;
+        };
+
+        struct Chunk {
+            uint32_t begin;
+            uint32_t end;
+            std::vector<Token> tokens;
+            std::vector<Segment> segments;
+            std::vector<Token> relexed;
+            std::vector<Piece> pieces;
+            size_t num_tokens;
+        };
+
+        // Number of tokens found by speculation which were not part of the true sequence
+        size_t discarded_tokens;
+
+        uint32_t startOf(const Token& token);
+        uint32_t nextLineStart(uint32_t offset);
+        void lexChunk(Chunk& chunk, bool first);
+        uint32_t reconcile(Chunk& chunk, uint32_t position);
+
+    public:
+        // Chunks smaller than this are not worth a thread of their own
+        static const size_t DEFAULT_MIN_CHUNK_SIZE = 1 << 20;
+
+        // The content must outlive the lexer and its tokens, as for Lexer.
+        // num_threads of 0 uses one thread per hardware thread
+        ChunkedLexer(std::string_view content, unsigned num_threads);
+        void setMinChunkSize(size_t min_chunk_size);
+
+        void parse();
+        const std::vector<Token>& getTokenSequence();
+
+        size_t getNumChunks();
+        size_t getDiscardedTokens();
+};
+
+#endif
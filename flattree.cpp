@@ -0,0 +1,137 @@
+#include "flattree.hpp"
+#include <stdexcept>
+
+FlatTree::FlatTree(){
+    this->nodes = { };
+    this->finished = false;
+}
+
+// While the tree is being built, nodes are in post-order and end holds the size of the subtree,
+// so the subtrees on top of the parser's stack are found by walking back from the last node.
+
+// Appends a node of the given type, with the token value (interned in getSymbols()) as its only child
+void FlatTree::pushLeaf(TreeNodeType type, uint32_t symbol, uint32_t source_start, uint32_t source_end){
+    if (finished){
+        throw std::runtime_error("Cannot add nodes to a finished flat tree");
+    }
+    nodes.push_back(FlatNode{type, symbol, 0, 1, source_start, source_end});
+    nodes.push_back(FlatNode{type, FlatNode::NO_VALUE, 1, 2, source_start, source_end});
+}
+
+void FlatTree::buildTree(TreeNodeType type, int num_children, uint32_t source_start, uint32_t source_end){
+    if (finished){
+        throw std::runtime_error("Cannot add nodes to a finished flat tree");
+    }
+    uint32_t size = 1;
+    uint32_t child_end = nodes.size();
+
+    // Each child's root is the last node of its subtree
+    for (int i=0; i<num_children; ++i){
+        uint32_t child_size = nodes[child_end-1].end;
+        size += child_size;
+        child_end -= child_size;
+    }
+    nodes.push_back(FlatNode{type, FlatNode::NO_VALUE, (uint32_t) num_children, size, source_start, source_end});
+}
+
+// Returns the number of subtrees built so far which have no parent yet
+size_t FlatTree::countRoots() const {
+    size_t roots = 0;
+    for (size_t end = nodes.size(); end > 0; end -= nodes[end-1].end){
+        roots++;
+    }
+    return roots;
+}
+
+// Discards the nodes added after the first num_nodes, while the tree is being built
+void FlatTree::truncate(size_t num_nodes){
+    if (finished){
+        throw std::runtime_error("Cannot truncate a finished flat tree");
+    }
+    nodes.resize(num_nodes);
+}
+
+// Reorders the nodes from post-order to pre-order, in linear time and without recursion
+void FlatTree::finish(){
+    if (finished || nodes.empty()){
+        finished = true;
+        return;
+    }
+    std::vector<FlatNode> ordered;
+    ordered.reserve(nodes.size());
+
+    // Post-order indices of the subtrees still to be emitted, the next one on top
+    std::vector<uint32_t> pending = { (uint32_t) nodes.size()-1 };
+
+    while (!pending.empty()){
+        uint32_t post = pending.back();
+        pending.pop_back();
+
+        FlatNode node = nodes[post];
+        uint32_t size = node.end;
+        node.end = ordered.size() + size;
+        ordered.push_back(node);
+
+        // Children end just before their parent, the last child first.
+        // Pushing them in that order leaves the first child on top.
+        uint32_t child_end = post;
+        for (uint32_t i=0; i<node.num_children; ++i){
+            pending.push_back(child_end-1);
+            child_end -= nodes[child_end-1].end;
+        }
+    }
+    nodes = std::move(ordered);
+    finished = true;
+}
+
+bool FlatTree::isFinished() const {
+    return finished;
+}
+
+size_t FlatTree::size() const {
+    return nodes.size();
+}
+
+const FlatNode& FlatTree::getNode(uint32_t index) const {
+    return nodes[index];
+}
+
+// Returns the token value for value leaves, and the type label for all other nodes
+std::string_view FlatTree::getLabel(uint32_t index) const {
+    if (nodes[index].value != FlatNode::NO_VALUE){
+        return values.getName(nodes[index].value);
+    }
+    return TreeNode::typeString(nodes[index].type);
+}
+
+// Returns the symbols of the token values in the tree
+Interner& FlatTree::getSymbols(){
+    return values;
+}
+
+const Interner& FlatTree::getSymbols() const {
+    return values;
+}
+
+// Writes the tree in the same format as TreeNode::pprintTree, in a single pass over the nodes
+void FlatTree::pprintTree(std::ostream& out) const {
+    // Ends of the subtrees enclosing the current node, the innermost on top
+    std::vector<uint32_t> enclosing = { };
+    std::string indent = "";
+
+    for (uint32_t i=0; i<nodes.size(); ++i){
+        while (!enclosing.empty() && enclosing.back() <= i){
+            enclosing.pop_back();
+        }
+        while (indent.size() < 2*enclosing.size()){
+            indent.append(". ");
+        }
+        if (i > 0){
+            out << "\n";
+        }
+        out.write(indent.data(), 2*enclosing.size());
+        out << getLabel(i) << "(" << nodes[i].num_children << ")";
+
+        enclosing.push_back(nodes[i].end);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <cstdint>
+#include "treenode.hpp"
+#include "intern.hpp"
+
+// A node of a FlatTree. 
+// Nodes are stored in pre-order, so the first child of a node (if any) immediately follows it,
+// and the next sibling of a child starts at the child's end.
+struct FlatNode {
+    TreeNodeType type;
+    uint32_t value;         // Symbol of the token value for value leaves, NO_VALUE for others
+    uint32_t num_children;
+    uint32_t end;           // Index one past the last node of this subtree
+    uint32_t source_start;  // Byte offsets in the source of the first and one past the last character covered
+    uint32_t source_end;
+
+    static const uint32_t NO_VALUE = UINT32_MAX;
+};
+
+// Index-based alternative to a tree of TreeNode pointers, held in a single vector.
+// The Parser emits nodes bottom-up (post-order) through pushLeaf and buildTree,
+// and finish() rearranges them into pre-order for traversal.
+class FlatTree {
+
+    private:
+        std::vector<FlatNode> nodes;
+        Interner values;
+        bool finished;
+
+    public:
+        FlatTree();
+
+        void pushLeaf(TreeNodeType type, uint32_t symbol, uint32_t source_start, uint32_t source_end);
+        void buildTree(TreeNodeType type, int num_children, uint32_t source_start, uint32_t source_end);
+        void finish();
+
+        size_t countRoots() const;
+        void truncate(size_t num_nodes);
+
+        bool isFinished() const;
+        size_t size() const;
+        const FlatNode& getNode(uint32_t index) const;
+        std::string_view getLabel(uint32_t index) const;
+        Interner& getSymbols();
+        const Interner& getSymbols() const;
+
+        void pprintTree(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include <array>
+#include "token.hpp"
+#include "treenode.hpp"
+
+// FIRST and select sets of the WinZigC grammar, used by the Parser to choose between productions.
+// They are built at compile time from one another, following the grammar's productions.
+namespace Grammar {
+
+    // Name -> '<identifier>'
+    constexpr TokenSet NAME_FIRST = { TokenType::IDENTIFER };
+
+    // ConstValue -> '<integer>' | '<char>' | Name
+    constexpr TokenSet CONST_VALUE_FIRST = TokenSet{ TokenType::INTEGER, TokenType::CHAR } | NAME_FIRST;
+
+    // Caseclause -> CaseExpression list ',' ':' Statement, where CaseExpression starts with a ConstValue
+    constexpr TokenSet CASECLAUSE_FIRST = CONST_VALUE_FIRST;
+
+    // Primary -> '-' Primary | '+' Primary | 'not' Primary | 'eof' | Name ... | '<integer>' | '<char>' 
+    //         | '(' Expression ')' | 'succ' ... | 'pred' ... | 'chr' ... | 'ord' ...
+    constexpr TokenSet PRIMARY_FIRST = TokenSet{
+        TokenType::MINUS, TokenType::PLUS, TokenType::NOT, TokenType::EOFT,
+        TokenType::INTEGER, TokenType::CHAR, TokenType::OPENBRKT,
+        TokenType::SUCC, TokenType::PRED, TokenType::CHR, TokenType::ORD
+    } | NAME_FIRST;
+
+    // Factor, Term and Expression all start with a Primary
+    constexpr TokenSet FACTOR_FIRST = PRIMARY_FIRST;
+    constexpr TokenSet TERM_FIRST = FACTOR_FIRST;
+    constexpr TokenSet EXPRESSION_FIRST = TERM_FIRST;
+
+    // Tokens which may follow a Statement, and so may follow an empty one
+    constexpr TokenSet STATEMENT_FOLLOW = {
+        TokenType::SEMICOLON, TokenType::END, TokenType::ELSE, TokenType::UNTIL, TokenType::POOL
+    };
+
+    // Tokens which a failed statement or declaration is skipped up to, when recovering from a syntax error
+    constexpr TokenSet SYNC_TOKENS = {
+        TokenType::SEMICOLON, TokenType::END, TokenType::POOL, TokenType::UNTIL, TokenType::FUNCTION
+    };
+
+    // Tokens which a failed parameter is skipped up to, staying within the parameter list
+    constexpr TokenSet PARAM_SYNC_TOKENS = { TokenType::SEMICOLON, TokenType::CLSBRKT };
+
+    // Tokens which a failed function is skipped up to (after its body, see Parser::skipFunction):
+    // the next function, or the program's body
+    constexpr TokenSet FCN_SYNC_TOKENS = { TokenType::FUNCTION, TokenType::BEGIN };
+
+    // Binary operators, from the loosest to the tightest binding level:
+    // relational operators join Terms, '+' '-' 'or' join Factors, and '*' '/' 'and' 'mod' join Primaries
+    const int RELATIONAL_PRECEDENCE = 1;
+    const int TERM_PRECEDENCE = 2;
+    const int FACTOR_PRECEDENCE = 3;
+
+    // Precedence and tree node of a binary operator, with a precedence of 0 for other tokens
+    struct BinaryOperator {
+        int precedence;
+        TreeNodeType node_type;
+    };
+
+    constexpr std::array<BinaryOperator, NUM_TOKEN_TYPES> makeBinaryOperators(){
+        std::array<BinaryOperator, NUM_TOKEN_TYPES> table = { };
+        table[static_cast<int>(TokenType::LEQ)]    = { RELATIONAL_PRECEDENCE, TreeNodeType::LEQ };
+        table[static_cast<int>(TokenType::LE)]     = { RELATIONAL_PRECEDENCE, TreeNodeType::LE };
+        table[static_cast<int>(TokenType::GEQ)]    = { RELATIONAL_PRECEDENCE, TreeNodeType::GEQ };
+        table[static_cast<int>(TokenType::GE)]     = { RELATIONAL_PRECEDENCE, TreeNodeType::GE };
+        table[static_cast<int>(TokenType::EQ)]     = { RELATIONAL_PRECEDENCE, TreeNodeType::EQ };
+        table[static_cast<int>(TokenType::NEQ)]    = { RELATIONAL_PRECEDENCE, TreeNodeType::NEQ };
+        table[static_cast<int>(TokenType::PLUS)]   = { TERM_PRECEDENCE, TreeNodeType::PLUS };
+        table[static_cast<int>(TokenType::MINUS)]  = { TERM_PRECEDENCE, TreeNodeType::MINUS };
+        table[static_cast<int>(TokenType::OR)]     = { TERM_PRECEDENCE, TreeNodeType::OR };
+        table[static_cast<int>(TokenType::MULT)]   = { FACTOR_PRECEDENCE, TreeNodeType::MULT };
+        table[static_cast<int>(TokenType::DIVIDE)] = { FACTOR_PRECEDENCE, TreeNodeType::DIVIDE };
+        table[static_cast<int>(TokenType::AND)]    = { FACTOR_PRECEDENCE, TreeNodeType::AND };
+        table[static_cast<int>(TokenType::MOD)]    = { FACTOR_PRECEDENCE, TreeNodeType::MOD };
+        return table;
+    }
+
+    // Indexed by TokenType
+    constexpr std::array<BinaryOperator, NUM_TOKEN_TYPES> BINARY_OPERATORS = makeBinaryOperators();
+}
+
+#endif
@@ -0,0 +1,208 @@
+#include "incremental.hpp"
+#include <stdexcept>
+
+IncrementalParser::IncrementalParser(){
+    this->generations.clear();
+    this->tree = nullptr;
+    this->diagnostics = { };
+    this->max_nesting = Parser::DEFAULT_MAX_NESTING;
+    this->incremental = false;
+    this->reused_functions = 0;
+}
+
+void IncrementalParser::setMaxNesting(int max_nesting){
+    this->max_nesting = max_nesting;
+}
+
+void IncrementalParser::parse(std::string content){
+    parseAll(std::move(content));
+}
+
+// Applies the edit to the content, and brings the tree up to date with it
+void IncrementalParser::applyEdit(const TextEdit& edit){
+    std::string_view old_content = getContent();
+    if (edit.offset > old_content.size() || edit.removed > old_content.size() - edit.offset){
+        throw std::runtime_error("Edit is outside the content");
+    }
+    std::unique_ptr<Generation> generation = std::make_unique<Generation>();
+    generation->content.reserve(old_content.size() - edit.removed + edit.inserted.size());
+    generation->content.append(old_content.substr(0, edit.offset));
+    generation->content.append(edit.inserted);
+    generation->content.append(old_content.substr(edit.offset + edit.removed));
+
+    if (!reparseFunction(edit, generation)){
+        parseAll(std::move(generation->content));
+    }
+}
+
+// Parses the whole content into a tree of its own, releasing every earlier version
+void IncrementalParser::parseAll(std::string content){
+    generations.clear();
+    generations.push_back(std::make_unique<Generation>());
+    generations.back()->content = std::move(content);
+    tree = nullptr;
+    diagnostics.clear();
+    incremental = false;
+    reused_functions = 0;
+
+    Generation& generation = *generations.back();
+    Lexer lexer (generation.content);
+    Parser parser = Parser(lexer, generation.arena);
+    parser.setMaxNesting(max_nesting);
+
+    parser.parseWinzig();
+    tree = parser.returnFinalTree();
+    diagnostics = parser.getDiagnostics();
+}
+
+// Tries to bring the tree up to date by reparsing only the function the edit falls in,
+// taking ownership of the new version of the content if it succeeds.
+// Returns false, leaving the tree as it was, if the whole program has to be parsed instead
+bool IncrementalParser::reparseFunction(const TextEdit& edit, std::unique_ptr<Generation>& generation){
+    // Only a tree without errors has a "fcn" node for every function.
+    // Each kept version also holds a copy of the content, so they are released from time to time
+    if (tree == nullptr || !diagnostics.empty() || generations.size() >= MAX_GENERATIONS){
+        return false;
+    }
+    TreeNode* subprogs = nullptr;
+    for (int i=0; i<tree->getNumChildren(); ++i){
+        if (tree->getChildren()[i]->getType() == TreeNodeType::SUBPROGS){
+            subprogs = tree->getChildren()[i];
+        }
+    }
+    if (subprogs == nullptr){
+        return false;
+    }
+
+    // Find the function the edit falls strictly inside. Its first and last characters must be kept,
+    // so that the tokens before and after it are not affected by the edit
+    TreeNode** fcns = subprogs->getChildren();
+    int num_fcns = subprogs->getNumChildren();
+    int lo = 0, hi = num_fcns;
+    while (lo < hi){
+        int mid = (lo + hi) / 2;
+        if (fcns[mid]->getEnd() <= edit.offset){
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    if (lo == num_fcns){
+        return false;
+    }
+    TreeNode* old_fcn = fcns[lo];
+    if (edit.offset <= old_fcn->getStart() || edit.offset + edit.removed >= old_fcn->getEnd()){
+        return false;
+    }
+    int64_t delta = (int64_t) edit.inserted.size() - edit.removed;
+
+    // Relex and reparse from the start of the function only
+    Lexer lexer (generation->content);
+    lexer.seek(old_fcn->getStart());
+    Parser parser = Parser(lexer, generation->arena);
+    parser.setMaxNesting(max_nesting);
+    try {
+        parser.parseFcn();
+    }
+    catch (const std::runtime_error& err){
+        // Reported by the full parse instead
+        return false;
+    }
+    TreeNode* new_fcn = parser.returnFinalTree();
+
+    // The new function must end where the old one did, or the rest of the program is lexed differently
+    if (!parser.getDiagnostics().empty() || new_fcn->getEnd() != old_fcn->getEnd() + delta){
+        return false;
+    }
+
+    shiftSpans(old_fcn, delta);
+    reinternSymbols(new_fcn);
+    fcns[lo] = new_fcn;
+
+    generations.push_back(std::move(generation));
+    incremental = true;
+    reused_functions = num_fcns - 1;
+    return true;
+}
+
+// Moves every node after the function by the change in length of the content, and stretches
+// the nodes enclosing it. Nodes before the function are left as they are
+void IncrementalParser::shiftSpans(TreeNode* fcn, int64_t delta){
+    uint32_t fcn_start = fcn->getStart();
+    uint32_t fcn_end = fcn->getEnd();
+
+    // Nodes still to be visited, and whether they are after the function
+    std::vector<std::pair<TreeNode*, bool>> pending = { {tree, false} };
+
+    while (!pending.empty()){
+        TreeNode* node = pending.back().first;
+        bool after = pending.back().second;
+        pending.pop_back();
+
+        if (node == fcn || (!after && node->getEnd() <= fcn_start)){
+            continue;
+        }
+        after = after || node->getStart() >= fcn_end;
+        if (after){
+            node->setSpan(node->getStart() + delta, node->getEnd() + delta);
+        }
+        else {
+            node->setSpan(node->getStart(), node->getEnd() + delta);
+        }
+        for (int i=0; i<node->getNumChildren(); ++i){
+            pending.push_back({node->getChildren()[i], after});
+        }
+    }
+}
+
+// Moves the symbols of a newly parsed function from its own arena's symbols to those of the tree,
+// so that equal names have equal symbols throughout the tree
+void IncrementalParser::reinternSymbols(TreeNode* fcn){
+    Interner& symbols = getSymbols();
+    std::vector<TreeNode*> pending = { fcn };
+
+    while (!pending.empty()){
+        TreeNode* node = pending.back();
+        pending.pop_back();
+
+        if (node->getSymbol() != Interner::NO_SYMBOL){
+            // A value leaf, or the node above one, which shares its symbol
+            TreeNode* leaf = (node->getNumChildren() == 0) ? node : node->getChildren()[0];
+            node->setSymbol(symbols.intern(leaf->getValue()));
+        }
+        for (int i=0; i<node->getNumChildren(); ++i){
+            pending.push_back(node->getChildren()[i]);
+        }
+    }
+}
+
+TreeNode* IncrementalParser::getTree(){
+    return tree;
+}
+
+std::string_view IncrementalParser::getContent(){
+    if (generations.empty()){
+        return std::string_view();
+    }
+    return generations.back()->content;
+}
+
+// Returns the symbols of the token values in the tree
+Interner& IncrementalParser::getSymbols(){
+    return generations.front()->arena.getSymbols();
+}
+
+const std::vector<Diagnostic>& IncrementalParser::getDiagnostics(){
+    return diagnostics;
+}
+
+// Returns whether the last edit reparsed a single function, rather than the whole program
+bool IncrementalParser::wasIncremental(){
+    return incremental;
+}
+
+// Returns the number of function subtrees reused by the last edit
+size_t IncrementalParser::getReusedFunctions(){
+    return reused_functions;
+}
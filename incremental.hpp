@@ -0,0 +1,71 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "treenode.hpp"
+#include "parser.hpp"
+
+// Replaces the removed number of bytes at a byte offset in the content with the inserted text
+struct TextEdit {
+    uint32_t offset;
+    uint32_t removed;
+    std::string inserted;
+};
+
+// Keeps the tree of a program up to date as its text is edited, for editors which reparse on every change.
+// An edit inside a single function is handled by relexing and reparsing only that function, and splicing
+// the new "fcn" subtree in place of the old one. Every other subtree is reused, with the spans of those
+// after the edit shifted. Any other edit (or one after which the function does not parse cleanly on its own)
+// falls back to parsing the whole program.
+// The symbols of the whole tree are those of the first version's arena, whichever version each node came from.
+class IncrementalParser {
+
+    private:
+        // A version of the content, with the arena of the nodes first parsed from it.
+        // Reused subtrees still refer to the version they were parsed from, so versions are kept
+        // until the next full parse, which happens at least every MAX_GENERATIONS edits
+        struct Generation {
+            std::string content;
+            TreeArena arena;
+        };
+        std::vector<std::unique_ptr<Generation>> generations;
+
+        TreeNode* tree;
+        std::vector<Diagnostic> diagnostics;
+        int max_nesting;
+
+        // How the last parse was done
+        bool incremental;
+        size_t reused_functions;
+
+        void parseAll(std::string content);
+        bool reparseFunction(const TextEdit& edit, std::unique_ptr<Generation>& generation);
+        void shiftSpans(TreeNode* fcn, int64_t delta);
+        void reinternSymbols(TreeNode* fcn);
+
+    public:
+        static const size_t MAX_GENERATIONS = 8;
+
+        IncrementalParser();
+        void setMaxNesting(int max_nesting);
+
+        // Lexical errors and the nesting limit are thrown from both of these, as from Parser::parseWinzig.
+        // The content is still updated, and the next edit parses it in full
+        void parse(std::string content);
+        void applyEdit(const TextEdit& edit);
+
+        // The tree is owned by the IncrementalParser, and is only valid until the next edit
+        TreeNode* getTree();
+        std::string_view getContent();
+        Interner& getSymbols();
+        const std::vector<Diagnostic>& getDiagnostics();
+
+        bool wasIncremental();
+        size_t getReusedFunctions();
+};
+
+#endif
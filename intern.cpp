@@ -0,0 +1,35 @@
+#include "intern.hpp"
+
+Interner::Interner(){
+    this->symbols = { };
+    this->names = { };
+}
+
+// Returns the symbol of the value, adding it if it has not been seen before
+uint32_t Interner::intern(std::string_view value){
+    auto found = symbols.try_emplace(value, (uint32_t) names.size());
+    if (found.second){
+        names.push_back(value);
+    }
+    return found.first->second;
+}
+
+// Returns the symbol of the value, or NO_SYMBOL if it has not been seen, without adding it
+uint32_t Interner::find(std::string_view value) const {
+    auto found = symbols.find(value);
+    return found == symbols.end() ? NO_SYMBOL : found->second;
+}
+
+std::string_view Interner::getName(uint32_t symbol) const {
+    return names[symbol];
+}
+
+// Returns the number of distinct values interned
+size_t Interner::size() const {
+    return names.size();
+}
+
+void Interner::clear(){
+    symbols.clear();
+    names.clear();
+}
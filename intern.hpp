@@ -0,0 +1,31 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Maps each distinct token value to a 32-bit symbol, numbered from 0 in the order first seen,
+// so that later passes can compare names by symbol instead of by text.
+// The interner keeps views of the values rather than copies, so the source must outlive it.
+// It is not thread-safe - each parse has its own (see TreeArena), so parallel parses share nothing.
+class Interner {
+
+    private:
+        std::unordered_map<std::string_view, uint32_t> symbols;
+        std::vector<std::string_view> names;
+
+    public:
+        static const uint32_t NO_SYMBOL = UINT32_MAX;
+
+        Interner();
+
+        uint32_t intern(std::string_view value);
+        uint32_t find(std::string_view value) const;
+        std::string_view getName(uint32_t symbol) const;
+        size_t size() const;
+        void clear();
+};
+
+#endif
@@ -2,13 +2,40 @@
 #include <cctype>
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include "scan.hpp"
 
-std::unordered_set<char> Lexer::whitespaces = {' ', '\t', '\n', '\f', '\r', '\v'};
-
-Lexer::Lexer(std::string content){
+// The lexer does not copy the content - it must outlive the lexer and the tokens it produces
+Lexer::Lexer(std::string_view content){
     this->content = content;
     this->position = this->content.begin();
+    this->stats = nullptr;
+    this->replayed = nullptr;
+    this->next_replayed = 0;
     tokens = { };
+    line_starts = { };
+}
+
+// Records the time spent scanning tokens (with hasNext/peek/next) and counts them by type
+void Lexer::setStats(Stats* stats){
+    this->stats = stats;
+}
+
+// Pointer to the current position, and the number of bytes from it to the end, for the Scan kernels
+const char* Lexer::cursor(){
+    return content.data() + (position - content.begin());
+}
+
+size_t Lexer::remaining(){
+    return content.end() - position;
+}
+
+// Returns the number of bytes before the next occurrence of the character, or to the end if there is none.
+// glibc's memchr already picks a vector implementation for the CPU, so strings and comments use it directly
+size_t Lexer::findOrEnd(char c){
+    const char* found = (const char*) memchr(cursor(), c, remaining());
+    return found ? found - cursor() : remaining();
 }
 
 bool Lexer::positionValid(){
@@ -18,105 +45,222 @@ bool Lexer::positionValid(){
     return false;
 }
 
-void Lexer::parse(){
+// Returns the byte offset in the content at which a token produced by this lexer starts.
+// Tokens hold no offset of their own - it is encoded by where their value points into the content
+uint32_t Lexer::getOffset(const Token& token){
+    return token.getValue().data() - content.data();
+}
 
-    while (positionValid()){
-        if (! consumePredefinedTokenIfPresent() ){
-
-            switch(Token::identifyNonPredefinedTokenType(*position)){
-                case TokenType::IDENTIFER:
-                    consumeIdentifier();
-                    break;
-                case TokenType::INTEGER:
-                    consumeInteger();
-                    break;
-                case TokenType::CHAR:
-                    consumeChar();
-                    break;
-                case TokenType::STRING:
-                    consumeString();
-                case TokenType::COMMENT_1:
-                    consumeCommentOne();
-                    break;
-                case TokenType::COMMENT_2:
-                    consumeCommentTwo();
-                    break;
-                default:
-                    break;
-            }
+// Returns the offset at which scanning continues, which is the start of the next token once whitespace is skipped
+uint32_t Lexer::getPosition(){
+    return position - content.begin();
+}
+
+size_t Lexer::getContentSize(){
+    return content.size();
+}
+
+// Returns the line and column of a byte offset in the content.
+// The line table is built with one pass over the content the first time, 
+// after which each lookup is a binary search over it
+SourceLocation Lexer::getLocation(size_t offset){
+    if (line_starts.empty()){
+        line_starts.push_back(0);
+        const char* begin = content.data();
+        const char* end = begin + content.size();
+        for (const char* p = begin; p < end && (p = (const char*) memchr(p, '\n', end - p)) != nullptr; ){
+            ++p;
+            line_starts.push_back(p - begin);
         }
+    }
+    offset = std::min(offset, content.size());
+
+    // The line is the last one starting at or before the offset
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - 1;
+    return SourceLocation{
+        (uint32_t) (line - line_starts.begin()) + 1,
+        (uint32_t) (offset - *line) + 1
+    };
+}
+
+// Returns a view of the content between the two iterators, which tokens refer to instead of a copy
+std::string_view Lexer::slice(std::string_view::iterator from, std::string_view::iterator to){
+    return std::string_view(content.data() + (from - content.begin()), to - from);
+}
+
+void Lexer::parse(){
+    while (positionValid()){
+        tokens.push_back( scanToken() );
+    }
+}
+
+// Reads the token at the current position, and any whitespace which follows it
+Token Lexer::scanToken(){
+
+    std::optional<Token> token = consumePredefinedTokenIfPresent();
+    if (token){
         consumeWhitespaceIfPresent();
+        return *token;
+    }
+
+    switch(Token::identifyNonPredefinedTokenType(*position)){
+        case TokenType::IDENTIFER:
+            token = consumeIdentifier();
+            break;
+        case TokenType::INTEGER:
+            token = consumeInteger();
+            break;
+        case TokenType::CHAR:
+            token = consumeChar();
+            break;
+        case TokenType::STRING:
+            token = consumeString();
+            break;
+        case TokenType::COMMENT_1:
+            token = consumeCommentOne();
+            break;
+        case TokenType::COMMENT_2:
+            token = consumeCommentTwo();
+            break;
+        default:
+            throw std::runtime_error("Token could not be identified.\n");
     }
+    consumeWhitespaceIfPresent();
+    return *token;
 }
 
-void Lexer::consumeWhitespaceIfPresent(){
-    while (positionValid() && whitespaces.count(*position)){
-        position++ ;
+// Returns whether there is another (non-comment) token, scanning ahead to it if required
+bool Lexer::hasNext(){
+    if (replayed){
+        return hasNextReplayed();
+    }
+    if (lookahead || !positionValid()){
+        return lookahead.has_value();
     }
+    std::chrono::steady_clock::time_point start;
+    if (stats){
+        start = std::chrono::steady_clock::now();
+    }
+
+    while (!lookahead && positionValid()){
+        Token t = scanToken();
+        if (t.getType() != TokenType::COMMENT_1 && t.getType() != TokenType::COMMENT_2){
+            lookahead = t;
+        }
+        else if (stats){
+            stats->comments_stripped++;
+        }
+        if (stats){
+            stats->token_counts[static_cast<int>(t.getType())]++;
+        }
+    }
+
+    if (stats){
+        stats->lex_time += Stats::secondsSince(start);
+    }
+    return lookahead.has_value();
 }
 
-bool Lexer::consumePredefinedTokenIfPresent(){
-    // Identify whether any of the predefined tokens match with the sequence of characters
-    // following the current pointer location
+// Returns the next (non-comment) token without consuming it
+Token Lexer::peek(){
+    if (!hasNext()){
+        throw std::runtime_error("Attempted to peek ahead at EOF");
+    }
+    return *lookahead;
+}
 
-    for (auto it: Token::predefined_tokens){
-        std::string token_value = it.second;
-        int token_length = token_value.size();
+// Returns the next (non-comment) token and consumes it
+Token Lexer::next(){
+    Token t = peek();
+    lookahead.reset();
+    return t;
+}
 
-        if (position+token_length < content.end()){
+// Continues scanning from the given offset, which must be the start of a token
+void Lexer::seek(uint32_t offset){
+    position = content.begin() + std::min<size_t>(offset, content.size());
+    lookahead.reset();
+    if (replayed){
+        next_replayed = std::lower_bound(replayed->begin(), replayed->end(), offset, [this](const Token& t, uint32_t offset){
+            return getOffset(t) < offset;
+        }) - replayed->begin();
+    }
+}
 
-            std::string content_slice (position, position+token_length);            
+void Lexer::replay(const std::vector<Token>& tokens){
+    this->replayed = &tokens;
+    this->next_replayed = 0;
+    lookahead.reset();
+}
 
-            if (content_slice == token_value){
+// hasNext() for replayed tokens, which skips and counts the comments in the same way
+bool Lexer::hasNextReplayed(){
+    while (!lookahead && next_replayed < replayed->size()){
+        const Token& t = (*replayed)[next_replayed++];
+        if (t.getType() != TokenType::COMMENT_1 && t.getType() != TokenType::COMMENT_2){
+            lookahead = t;
+        }
+        else if (stats){
+            stats->comments_stripped++;
+        }
+        if (stats){
+            stats->token_counts[static_cast<int>(t.getType())]++;
+        }
+    }
+    return lookahead.has_value();
+}
 
-                // Now that the token has been recognized in the text, 
-                // Check whether it's possibly a piece of an identifier isntead (eg- "orange" = "or"+"range")
-                // Condition - If token is all alphabetic, the next character also shouldn't be.
+void Lexer::consumeWhitespaceIfPresent(){
+    position += Scan::whitespaceRun(cursor(), remaining());
+}
 
-                bool isIdentifier = true; 
-                for (int i=0; i<token_length+1; ++i){
-                    if (!isalpha(*(position+i))){
-                        isIdentifier = false;
-                    }
-                }
-                if (isIdentifier){
-                    continue; // moves onto the next predefined token type
-                }
+std::optional<Token> Lexer::consumePredefinedTokenIfPresent(){
+    // Identify whether any of the predefined tokens match with the sequence of characters
+    // following the current pointer location, classifying the position in a single pass
+
+    size_t remaining = this->remaining();
+    size_t token_length = Scan::letterRun(cursor(), remaining);
+    TokenType type;
 
-                position += token_length;
-                tokens.push_back( Token(it.first) ); 
-                return true;
-            }
+    if (token_length > 0){
+        // A keyword must be the whole alphabetic run, otherwise it's a piece of an identifier
+        // instead (eg- "orange" = "or"+"range")
+        // The keyword must also be followed by at least one character
+        if (token_length == remaining || !Token::identifyKeyword(&*position, token_length, type)){
+            return std::nullopt;
         }
     }
-    return false;
+    else {
+        token_length = Token::identifyOperator(&*position, remaining, type);
+        if (token_length == 0){
+            return std::nullopt;
+        }
+    }
+
+    position += token_length;
+    // The value refers to the source like any other token, so its offset in the source is known
+    return Token(type, slice(position-token_length, position));
 }
 
-void Lexer::consumeIdentifier(){
+Token Lexer::consumeIdentifier(){
     // position iterator is on the first letter of the identifier, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
     position ++;
-
-    while (positionValid() && (isalnum(*position) || *position=='_' )){
-        position++;
-    }
-    tokens.push_back( Token(TokenType::IDENTIFER, std::string(temp, position)) );
+    position += Scan::identifierRun(cursor(), remaining());
+    return Token(TokenType::IDENTIFER, slice(temp, position));
 }
 
-void Lexer::consumeInteger(){
+Token Lexer::consumeInteger(){
     // position iterator is on the first letter of the integer, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
     position ++;
-
-    while (positionValid() && isdigit(*position) ){
-        position++;
-    }
-    tokens.push_back( Token(TokenType::INTEGER, std::string(temp, position)) );
+    position += Scan::digitRun(cursor(), remaining());
+    return Token(TokenType::INTEGER, slice(temp, position));
 }
 
-void Lexer::consumeChar(){
+Token Lexer::consumeChar(){
     // position iterator is on the first quote of the char, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
 
     position ++;
     if (positionValid() && *position =='\''){
@@ -131,56 +275,46 @@ void Lexer::consumeChar(){
     if (!positionValid()){ 
         throw std::runtime_error("EOF reached while parsing char \n");
     }
-    tokens.push_back( Token(TokenType::CHAR, std::string(temp, temp+3)) );
     position ++;
+    return Token(TokenType::CHAR, slice(temp, temp+3));
 }
 
-void Lexer::consumeString(){
+Token Lexer::consumeString(){
     // position iterator is on the first double quote of the string, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
 
     position ++;
-    while (positionValid() && *position!='"'){
-        position ++;
-    }
+    position += findOrEnd('"');
     if (!positionValid()){ 
         throw std::runtime_error("EOF reached while parsing string \n");
     }
-    if (*position == '"'){
-        tokens.push_back( Token(TokenType::STRING, std::string(temp+1, position)) );
-        position++;
-    }
+    // position is now on the closing double quote
+    position++;
+    return Token(TokenType::STRING, slice(temp+1, position-1));
 }
 
-void Lexer::consumeCommentOne(){
+Token Lexer::consumeCommentOne(){
     // position iterator is on the first letter of the identifier, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
     position ++;
-
-    while (positionValid() && *position != '\n'){
-        position++;
-    }
+    position += findOrEnd('\n');
     // Whether it's now at EOF or a newline, the comment is complete
-    tokens.push_back( Token(TokenType::COMMENT_1, std::string(temp, position)) );
+    return Token(TokenType::COMMENT_1, slice(temp, position));
 }
 
-void Lexer::consumeCommentTwo(){
+Token Lexer::consumeCommentTwo(){
     // position iterator is on the first letter of the identifier, which was already checked
-    std::string::iterator temp { position };
+    std::string_view::iterator temp { position };
     position ++;
-
-    while (positionValid() && *position!='}'){
-        position++;
-    }
+    position += findOrEnd('}');
     if (!positionValid()){ 
         throw std::runtime_error("EOF reached while parsing multiline comment \n");
     }
-    if (*position == '}'){
-        tokens.push_back( Token(TokenType::COMMENT_2, std::string(temp, position+1)) );
-        position++;
-    }
+    // position is now on the closing brace
+    position++;
+    return Token(TokenType::COMMENT_2, slice(temp, position));
 }
 
-std::vector<Token> Lexer::getTokenSequence(){
+const std::vector<Token>& Lexer::getTokenSequence(){
     return tokens;
 }
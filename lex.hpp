@@ -3,34 +3,80 @@
 
 #include <string>
 #include <vector>
+#include <optional>
 #include "token.hpp"
-#include <unordered_set>
+#include "stats.hpp"
+
+// Position in the source, counting lines and columns (in bytes) from 1
+struct SourceLocation {
+    uint32_t line;
+    uint32_t column;
+};
 
 class Lexer {
 
     private:
-        std::string content;
-        std::string::iterator position;
+        std::string_view content;
+        std::string_view::iterator position;
         std::vector<Token> tokens;
 
-        static std::unordered_set<char> whitespaces;
+        // The next non-comment token, once it has been scanned by peek()
+        // One token of lookahead is all the parser needs
+        std::optional<Token> lookahead;
+
+        // Set when scanning should be timed and counted
+        Stats* stats;
+
+        // Set when tokens are pulled from a sequence lexed already, instead of being scanned,
+        // with the index of the next one to pull
+        const std::vector<Token>* replayed;
+        size_t next_replayed;
+
+        // Offset at which each line starts, in order. Built on the first call to getLocation
+        std::vector<uint32_t> line_starts;
+
+        const char* cursor();
+        size_t remaining();
+        size_t findOrEnd(char c);
+        bool hasNextReplayed();
 
     public:
-        Lexer(std::string content);
+        Lexer(std::string_view content);
+        void setStats(Stats* stats);
+
+        // Tokenizes the whole content (including comments) into the token sequence
         void parse();
+        const std::vector<Token>& getTokenSequence();
+
+        // Pull-based interface, which skips comments and keeps no token sequence
+        // Use either this or parse() on a given lexer, not both
+        bool hasNext();
+        Token peek();
+        Token next();
+        void seek(uint32_t offset);
+
+        // Pulls the tokens from a sequence of the whole content lexed already (eg- by a ChunkedLexer), 
+        // which must outlive the lexer, instead of scanning them
+        void replay(const std::vector<Token>& tokens);
 
-        std::vector<Token> getTokenSequence();
+        // Positions are 32-bit byte offsets into the content, which must be smaller than 4 GiB
+        uint32_t getOffset(const Token& token);
+        uint32_t getPosition();
+        size_t getContentSize();
+        SourceLocation getLocation(size_t offset);
 
         bool positionValid();
+        std::string_view slice(std::string_view::iterator from, std::string_view::iterator to);
+        Token scanToken();
 
         void consumeWhitespaceIfPresent();
-        bool consumePredefinedTokenIfPresent();
-        void consumeIdentifier();
-        void consumeInteger();
-        void consumeChar();
-        void consumeString();
-        void consumeCommentOne();
-        void consumeCommentTwo();
+        std::optional<Token> consumePredefinedTokenIfPresent();
+        Token consumeIdentifier();
+        Token consumeInteger();
+        Token consumeChar();
+        Token consumeString();
+        Token consumeCommentOne();
+        Token consumeCommentTwo();
 };
 
 #endif
\ No newline at end of file
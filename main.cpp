@@ -1,80 +1,339 @@
 #include <string>
 #include <iostream>
-#include <fstream>
 #include <vector>
+#include <algorithm>
 
+#include "source.hpp"
 #include "lex.hpp"
+#include "chunklexer.hpp"
 #include "token.hpp"
 #include "parser.hpp"
+#include "batch.hpp"
+#include "stats.hpp"
+#include "cache.hpp"
+#include "binarytree.hpp"
+#include "semantic.hpp"
+#include "typecheck.hpp"
+#include <sstream>
+#include <memory>
+
+// Runs batch mode, with arguments: --batch [-j threads] [-o output_dir] (file | directory)+
+int runBatch(const std::vector<std::string>& args, int max_nesting, ParseCache* cache){
+    std::string output_dir = "";
+    unsigned num_threads = 0;
+    size_t i = 1;
+
+    while (i+1 < args.size() && (args[i]=="-j" || args[i]=="-o")){
+        if (args[i]=="-j"){
+            num_threads = std::stoul(args[i+1]);
+        }
+        else {
+            output_dir = args[i+1];
+        }
+        i += 2;
+    }
+    if (i >= args.size()){
+        std::cout << "Error: Argument format incorrect. \n";
+        return 1;
+    }
+
+    BatchRunner runner (output_dir, num_threads);
+    runner.setMaxNesting(max_nesting);
+    runner.setCache(cache);
+    for (; i<args.size(); ++i){
+        runner.addInput(args[i]);
+    }
+    return runner.run();
+}
 
 int main(int argc, char *argv[]){
 
+    // The tree is written straight to std::cout, so let it buffer independently of stdio
+    std::ios::sync_with_stdio(false);
+
     //std::cout << "Program started \n";
     
     std::string input_file_path; 
-    std::ifstream file; 
+
+    // "--stats" may be given anywhere, and prints a JSON report of the run to stderr
+    // "--max-depth N" may be given anywhere, and limits how deeply statements and expressions may nest
+    // "--cache DIR" may be given anywhere, and reuses the trees of unchanged files from earlier runs,
+    // keeping at most "--cache-size MB" megabytes of them
+    // "--emit=bin" writes the tree in the binary form instead of as text (see binarytree.hpp)
+    // "--check" also resolves the names of the program and checks its types, and reports errors in them instead of the tree
+    // "--lex-threads N" lexes the whole file on N threads (0 for one per core) before parsing it,
+    // instead of as the parser pulls the tokens
+    std::vector<std::string> args = { };
+    bool print_stats = false;
+    bool emit_binary = false;
+    bool check = false;
+    int lex_threads = -1;
+    int max_nesting = Parser::DEFAULT_MAX_NESTING;
+    std::string cache_dir = "";
+    uint64_t cache_max_bytes = ParseCache::DEFAULT_MAX_BYTES;
+    for (int i=1; i<argc; ++i){
+        if (std::string(argv[i])=="--stats"){
+            print_stats = true;
+        }
+        else if ((std::string(argv[i])=="--max-depth") && (i+1<argc)){
+            try{
+                max_nesting = std::stoi(argv[++i]);
+            }
+            catch (const std::exception& err){
+                std::cout << "Error: Argument format incorrect. \n";
+                exit(1);
+            }
+        }
+        else if ((std::string(argv[i])=="--emit=bin") || (std::string(argv[i])=="--emit=text")){
+            emit_binary = (std::string(argv[i])=="--emit=bin");
+        }
+        else if (std::string(argv[i])=="--check"){
+            check = true;
+        }
+        else if ((std::string(argv[i])=="--lex-threads") && (i+1<argc)){
+            try{
+                lex_threads = std::stoi(argv[++i]);
+            }
+            catch (const std::exception& err){
+                lex_threads = -1;
+            }
+            if (lex_threads < 0){
+                std::cout << "Error: Argument format incorrect. \n";
+                exit(1);
+            }
+        }
+        else if ((std::string(argv[i])=="--cache") && (i+1<argc)){
+            cache_dir = argv[++i];
+        }
+        else if ((std::string(argv[i])=="--cache-size") && (i+1<argc)){
+            try{
+                cache_max_bytes = std::stoull(argv[++i]) * 1024 * 1024;
+            }
+            catch (const std::exception& err){
+                std::cout << "Error: Argument format incorrect. \n";
+                exit(1);
+            }
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    std::unique_ptr<ParseCache> cache;
+    if (!cache_dir.empty()){
+        cache = std::make_unique<ParseCache>(cache_dir, cache_max_bytes);
+    }
+
+    // "--print-bin FILE" prints a tree written by --emit=bin as text
+    if ((args.size()==2) && (args[0]=="--print-bin")){
+        try{
+            BinaryTree tree (args[1]);
+            tree.pprintTree(std::cout);
+            std::cout << "\n";
+        }
+        catch (const std::exception& err){
+            std::cout << err.what() << "\n";
+            exit(1);
+        }
+        exit(0);
+    }
+
+    if ((args.size()>=1) && (args[0]=="--batch")){
+        if (emit_binary){
+            std::cout << "Error: --emit=bin is not supported in batch mode. \n";
+            exit(1);
+        }
+        if (check){
+            std::cout << "Error: --check is not supported in batch mode. \n";
+            exit(1);
+        }
+        if (lex_threads >= 0){
+            std::cout << "Error: --lex-threads is not supported in batch mode. \n";
+            exit(1);
+        }
+        try{
+            exit(runBatch(args, max_nesting, cache.get()));
+        }
+        catch (const std::exception& err){
+            std::cout << "Error: " << err.what() << "\n";
+            exit(1);
+        }
+    }
+    Stats stats;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
     // Accept argument preceded by "--ast", "-ast", or none
-    if ((argc==3) && ((std::string(argv[1])=="--ast") || (std::string(argv[1])=="-ast"))) {
-        input_file_path = argv[2];
+    if ((args.size()==2) && ((args[0]=="--ast") || (args[0]=="-ast"))) {
+        input_file_path = args[1];
     }
-    else if (argc==2){
-        input_file_path = argv[1];
+    else if (args.size()==1){
+        input_file_path = args[0];
     }
     else{
         std::cout << "Error: Argument format incorrect. \n";
         exit(1);
     }
 
-    file.open(input_file_path);
-    if (!file){
-        std::cout << "Error: Could not read file. \n";
-        exit(1);
-    }
-
-    // Read the content of the file
-    std::string content (std::istreambuf_iterator<char>{file}, {});
-    file.close();
-
-    // Convert the content into tokens
-    Lexer lexer (content);
-    std::vector<Token> token_sequence;
-
+    // Map the content of the file, which is then lexed in place without copies
+    std::unique_ptr<SourceFile> source;
     try{
-        lexer.parse();   
-        token_sequence = lexer.getTokenSequence();
-        //std::cout << "Lexical analysis complete \n"; 
+        source = std::make_unique<SourceFile>(input_file_path);
     }
     catch (const std::runtime_error& err){
         std::cout << err.what() << "\n"; 
         exit(1);
     }
-    
+    stats.read_time = Stats::secondsSince(start);
+
+    // An unchanged file's tree is written straight from the cache, without lexing or parsing
+    std::string cache_key = "";
+    if (cache){
+        start = std::chrono::steady_clock::now();
+        // Checked runs are kept apart, so that a tree cached without checking is not taken as checked.
+        // So are runs with different nesting limits, as a tree within one limit may exceed another
+        cache_key = ParseCache::keyFor(source->getContent(), std::string(emit_binary ? "bin" : "ast") + (check ? "-checked" : "")
+                                       + "-depth" + std::to_string(max_nesting));
+        std::unique_ptr<SourceFile> cached = cache->load(cache_key);
+        if (cached){
+            std::cout.write(cached->getContent().data(), cached->getContent().size());
+            std::cout.flush();
+            stats.print_time = Stats::secondsSince(start);
+            stats.cache_hits = 1;
+            if (print_stats){
+                stats.printJson(std::cerr);
+            }
+            return 0;
+        }
+        stats.cache_misses = 1;
+    }
+
+    // The content is converted into tokens as the parser requests them, 
+    // or all at once by the chunked lexer, from whose tokens the parser's are then taken
+    Lexer lexer (source->getContent());
+    if (print_stats){
+        lexer.setStats(&stats);
+    }
+    std::unique_ptr<ChunkedLexer> chunked_lexer;
+    if (lex_threads >= 0){
+        chunked_lexer = std::make_unique<ChunkedLexer>(source->getContent(), lex_threads);
+    }
+
     // Save lexer output tokens for debugging purposes
+    // Lexer debug_lexer (source->getContent());
+    // debug_lexer.parse();
     // std::ofstream token_seq_file("token_seq.txt");
-    // for (Token t: token_sequence){
+    // for (Token t: debug_lexer.getTokenSequence()){
     //     token_seq_file << static_cast<std::underlying_type<TokenType>::type>(t.getType()) << " : " <<t.getValue() << "\n";
     // } 
     // token_seq_file.close();
 
-    // Parse the tokens into an AST
-    Parser parser = Parser(token_sequence);
+    // Parse the tokens into an AST, owned by the arena (or held in a flat tree, for the binary form and checking)
+    // Lexical errors are also reported from here
+    TreeArena arena;
+    FlatTree flat;
+    bool use_flat = emit_binary || check;
+    Parser parser = use_flat ? Parser(lexer, flat) : Parser(lexer, arena);
+    parser.setMaxNesting(max_nesting);
 
     try{
+        start = std::chrono::steady_clock::now();
+        if (chunked_lexer){
+            chunked_lexer->parse();
+            lexer.replay(chunked_lexer->getTokenSequence());
+            stats.lex_time += Stats::secondsSince(start);
+        }
         parser.parseWinzig();
-        TreeNode* ast = parser.returnFinalTree();
-        std::cout << ast->pprintTree(0) << "\n";
+
+        // Report every syntax error found, instead of the (partial) tree
+        if (!parser.getDiagnostics().empty()){
+            for (const Diagnostic& d: parser.getDiagnostics()){
+                std::cout << d.location.line << ":" << d.location.column << ": " << d.message << "\n";
+            }
+            return 1;
+        }
+        // Lexing is interleaved with parsing, so its share is taken out of the parse time
+        stats.parse_time = Stats::secondsSince(start) - stats.lex_time;
+
+        // Report every error in the names and types of the program, instead of the tree
+        if (check){
+            start = std::chrono::steady_clock::now();
+            SemanticAnalyzer analyzer (parser.returnFinalFlatTree(), lexer, 0);
+            analyzer.analyze();
+            TypeChecker checker (parser.returnFinalFlatTree(), lexer, analyzer);
+            checker.check();
+            stats.check_time = Stats::secondsSince(start);
+
+            std::vector<Diagnostic> diagnostics = analyzer.getDiagnostics();
+            diagnostics.insert(diagnostics.end(), checker.getDiagnostics().begin(), checker.getDiagnostics().end());
+            if (!diagnostics.empty()){
+                std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b){
+                    return a.location.line < b.location.line
+                        || (a.location.line == b.location.line && a.location.column < b.location.column);
+                });
+                for (const Diagnostic& d: diagnostics){
+                    std::cout << d.location.line << ":" << d.location.column << ": " << d.message << "\n";
+                }
+                return 1;
+            }
+        }
+
+        start = std::chrono::steady_clock::now();
+        if (cache){
+            // Written once, for both the output and the cache
+            std::ostringstream tree;
+            if (emit_binary){
+                BinaryTree::write(parser.returnFinalFlatTree(), tree);
+            }
+            else if (use_flat){
+                parser.returnFinalFlatTree().pprintTree(tree);
+                tree << "\n";
+            }
+            else {
+                parser.returnFinalTree()->pprintTree(tree);
+                tree << "\n";
+            }
+            std::string output = tree.str();
+            std::cout.write(output.data(), output.size());
+            std::cout.flush();
+            cache->store(cache_key, output);
+            cache->evict();
+        }
+        else if (emit_binary){
+            BinaryTree::write(parser.returnFinalFlatTree(), std::cout);
+            std::cout.flush();
+        }
+        else if (use_flat){
+            // Streamed, as the tree of a checked program may be far larger than the program
+            parser.returnFinalFlatTree().pprintTree(std::cout);
+            std::cout << "\n";
+            std::cout.flush();
+        }
+        else {
+            parser.returnFinalTree()->pprintTree(std::cout);
+            std::cout << "\n";
+            std::cout.flush();
+        }
+        stats.print_time = Stats::secondsSince(start);
 
         // Save parser output to file
         // Removed as this happens automatically on running command
         // std::ofstream output_file("ast.txt");
-        // output_file << ast->pprintTree(0);
+        // ast->pprintTree(output_file);
         // output_file.close();
     }
     catch (const std::runtime_error& err){
         std::cout << err.what() << "\n"; 
-        exit(1); 
+        return 1; 
     }
 
-    exit(0);
+    if (print_stats){
+        stats.nodes_allocated = use_flat ? flat.size() : arena.getNodeCount();
+        stats.bytes_allocated = use_flat ? flat.size() * sizeof(FlatNode) : arena.getBytesAllocated();
+        stats.symbols = use_flat ? flat.getSymbols().size() : arena.getSymbols().size();
+        stats.max_stack_depth = parser.getMaxStackDepth();
+        stats.max_statement_depth = parser.getMaxStatementDepth();
+        stats.max_expression_depth = parser.getMaxExpressionDepth();
+        stats.printJson(std::cerr);
+    }
+    return 0;
 }
\ No newline at end of file
@@ -1,78 +1,122 @@
 #include "parser.hpp"
 #include <stdexcept>
-#include <unordered_set>
+#include <algorithm>
 #include <iostream>
 
-Parser::Parser(std::vector<Token> lexer_tokens){
-    this->tokens = { };
-    // Strip comment tokens from the list
-    for (Token t: lexer_tokens){
-        if (t.getType() != TokenType::COMMENT_1 && t.getType() != TokenType::COMMENT_2){
-            this->tokens.push_back(t);
+// Counts a level of recursion for as long as it is in scope, and records the deepest level reached
+struct DepthGuard {
+    int& depth;
+
+    DepthGuard(int& depth, int& max_depth) : depth(depth) {
+        if (++depth > max_depth){
+            max_depth = depth;
+        }
+    }
+    ~DepthGuard(){
+        depth--;
+    }
+};
+
+// Counts a level of nesting for as long as it is in scope, 
+// failing cleanly once the limit is reached rather than recursing further
+struct NestingGuard {
+    int& nesting;
+
+    NestingGuard(int& nesting, int max_nesting) : nesting(nesting) {
+        if (nesting >= max_nesting){
+            throw std::runtime_error("Nesting depth limit of " + std::to_string(max_nesting) + " exceeded");
         }
+        nesting++;
     }
-    this->position = this->tokens.begin();
+    ~NestingGuard(){
+        nesting--;
+    }
+};
+
+SyntaxError::SyntaxError(const std::string& message, size_t offset) : std::runtime_error(message) {
+    this->offset = offset;
+}
+
+// Tokens are pulled from the lexer as they are needed
+// Tree nodes are allocated in the given arena, which owns the final tree
+Parser::Parser(Lexer& lexer, TreeArena& arena)
+    : Parser(lexer, &arena, nullptr) { }
+
+// Nodes are emitted into the given flat tree instead of being allocated individually
+Parser::Parser(Lexer& lexer, FlatTree& flat)
+    : Parser(lexer, nullptr, &flat) { }
+
+Parser::Parser(Lexer& lexer, TreeArena* arena, FlatTree* flat) : lexer(lexer) {
+    this->arena = arena;
+    this->flat = flat;
+    this->symbols = arena ? &arena->getSymbols() : &flat->getSymbols();
     this->stack = { };
+    this->num_roots = 0;
+    this->statement_depth = 0;
+    this->expression_depth = 0;
+    this->max_statement_depth = 0;
+    this->max_expression_depth = 0;
+    this->max_stack_depth = 0;
+    this->nesting = 0;
+    this->max_nesting = DEFAULT_MAX_NESTING;
+    this->diagnostics = { };
+    this->last_error_offset = SIZE_MAX;
+    this->last_token_end = 0;
+}
+
+// Sets how deeply statements and expressions may nest before parsing fails.
+// Each level uses native stack, so this should be lowered for threads with small stacks.
+void Parser::setMaxNesting(int max_nesting){
+    this->max_nesting = max_nesting;
 }
 
 bool Parser::positionValid(){
-    if (position < tokens.end() ){
-        return true;
-    }
-    return false;
+    return lexer.hasNext();
 }
 
 Token Parser::peekNextToken(){
-    if (position < tokens.end()){
-        return *(position);
+    if (!lexer.hasNext()){
+        throw SyntaxError("Unexpected end of file", lexer.getContentSize());
     }
-    throw std::runtime_error("Attempted to peek ahead at EOF");
+    return lexer.peek();
 }
 
 // Consumes the token at the current position and push a tree node to stack if required.
 void Parser::readToken(){
 
-    Token t = *position;
-    TreeNode* tn;
+    Token t = lexer.next();
+    last_token_end = lexer.getOffset(t) + t.getValue().size();
 
     switch (t.getType()){
         case TokenType::IDENTIFER:
-            tn = new TreeNode(TreeNodeType::IDENTIFER);
-            tn->addChild(new TreeNode(t.getValue()));
-            stack.push(tn);
+            pushLeaf(TreeNodeType::IDENTIFER, t);
             break;
 
         case TokenType::INTEGER:
-            tn = new TreeNode(TreeNodeType::INTEGER);
-            tn->addChild(new TreeNode(t.getValue()));
-            stack.push(tn);
+            pushLeaf(TreeNodeType::INTEGER, t);
             break;
 
         case TokenType::CHAR:
-            tn = new TreeNode(TreeNodeType::CHAR);
-            tn->addChild(new TreeNode(t.getValue()));
-            stack.push(tn);
+            pushLeaf(TreeNodeType::CHAR, t);
             break;
 
         case TokenType::STRING:
-            tn = new TreeNode(TreeNodeType::STRING);
-            tn->addChild(new TreeNode(t.getValue()));
-            stack.push(tn);
+            pushLeaf(TreeNodeType::STRING, t);
             break;
 
         default:
             // Do not construct tree nodes for other types of tokens
             break;
     }
-    position ++;
 }
 
 // Consumes the token at the current position only if it is of the expected type
 void Parser::readExpectedToken(TokenType type){
-    if (peekNextToken().getType() != type){
-        throw std::runtime_error(
-            "Expected token of type " + std::to_string((int) type) +
-            ", got token of type " + std::to_string((int) peekNextToken().getType())
+    Token t = peekNextToken();
+    if (t.getType() != type){
+        throw SyntaxError(
+            "Expected " + Token::describe(type) + ", got " + Token::describe(t.getType()),
+            lexer.getOffset(t)
         );
     }
     else {
@@ -80,31 +124,171 @@ void Parser::readExpectedToken(TokenType type){
     }
 }
 
-void Parser::buildTree(TreeNodeType type, int num_children){
+// Returns the offset at which a node built from the next token onwards starts
+uint32_t Parser::nodeStart(){
+    return lexer.hasNext() ? lexer.getOffset(lexer.peek()) : lexer.getContentSize();
+}
+
+// Pushes a node of the given type, with the token value as its only child. 
+// Both span the token, and carry the symbol of its value
+void Parser::pushLeaf(TreeNodeType type, const Token& token){
+    uint32_t start = lexer.getOffset(token);
+    uint32_t end = start + token.getValue().size();
+    uint32_t symbol = symbols->intern(token.getValue());
+    if (flat){
+        flat->pushLeaf(type, symbol, start, end);
+    }
+    else {
+        TreeNode* tn = arena->newNode(type);
+        TreeNode** children = arena->newChildren(1);
+        children[0] = arena->newNode(token.getValue(), symbol);
+        children[0]->setSpan(start, end);
+        tn->setChildren(children, 1);
+        tn->setSpan(start, end);
+        tn->setSymbol(symbol);
+        stack.push_back(tn);
+    }
+    num_roots++;
+    max_stack_depth = std::max(max_stack_depth, num_roots);
+}
 
-    TreeNode* tn = new TreeNode(type);
-    std::stack<TreeNode*> temp = { };
+// Builds a node over the top num_children subtrees of the stack. It spans from the given start
+// (taken with nodeStart() before the production's first token) to the end of the last token read,
+// or is empty at start if no token was read since
+void Parser::buildTree(TreeNodeType type, int num_children, uint32_t start){
+    uint32_t end = std::max(start, last_token_end);
 
-    for (int i=0; i<num_children; ++i){
-        temp.push(stack.top());
-        stack.pop();
+    if (flat){
+        flat->buildTree(type, num_children, start, end);
     }
+    else {
+        TreeNode* tn = arena->newNode(type);
+        TreeNode** children = arena->newChildren(num_children);
 
-    for (int i=0; i<num_children; ++i){
-        tn->addChild(temp.top());
-        temp.pop();
+        // The children are the top num_children entries of the stack, in order
+        std::copy(stack.end() - num_children, stack.end(), children);
+        stack.resize(stack.size() - num_children);
+
+        tn->setChildren(children, num_children);
+        tn->setSpan(start, end);
+        stack.push_back(tn);
     }
-    stack.push(tn);
+    num_roots = num_roots - num_children + 1;
+    max_stack_depth = std::max(max_stack_depth, num_roots);
 }
 
 TreeNode* Parser::returnFinalTree(){
-    return stack.top();
+    return stack.back();
+}
+
+// Adds the error to the diagnostics, unless it is at the same place as the last one 
+// (as happens when the same error unwinds through several productions)
+void Parser::recordError(const SyntaxError& err){
+    if (err.offset == last_error_offset){
+        return;
+    }
+    last_error_offset = err.offset;
+    diagnostics.push_back(Diagnostic{lexer.getLocation(err.offset), err.what()});
+}
+
+const std::vector<Diagnostic>& Parser::getDiagnostics(){
+    return diagnostics;
+}
+
+// Returns a mark of how much of the tree has been built, which it can be rewound to
+size_t Parser::treeMark(){
+    return flat ? flat->size() : stack.size();
+}
+
+// Recovers from a syntax error in a production which started at the given mark and offset:
+// records the error, discards the nodes pushed since the mark, skips ahead to one of 
+// the sync tokens (or EOF) and pushes a "<null>" node spanning the production in its place.
+// Returns the number of tree nodes added to the stack
+int Parser::recover(const SyntaxError& err, size_t mark, uint32_t start, TokenSet sync_tokens){
+    recordError(err);
+
+    if (flat){
+        flat->truncate(mark);
+        num_roots = flat->countRoots();
+    }
+    else {
+        stack.resize(mark);
+        num_roots = stack.size();
+    }
+    while (lexer.hasNext() && !sync_tokens.contains(lexer.peek().getType())){
+        Token t = lexer.next();
+        last_token_end = lexer.getOffset(t) + t.getValue().size();
+    }
+    buildTree(TreeNodeType::NNULL, 0, start);
+    return 1;
+}
+
+// Skips the rest of a failed function, given how many blocks deep in its body the error was
+// (0 if the body was not reached): through the 'end' closing its body, then its name and ';'.
+// The body is found by its 'begin' and the blocks in it by 'begin' and 'case', each closed by an 'end'.
+// Stops early at 'function', which can only start the next function
+void Parser::skipFunction(int depth){
+    bool closed = false;
+    while (!closed && lexer.hasNext() && lexer.peek().getType() != TokenType::FUNCTION){
+        TokenType type = lexer.peek().getType();
+        if (type == TokenType::BEGIN || (depth > 0 && type == TokenType::CASE)){
+            depth++;
+        }
+        else if (depth > 0 && type == TokenType::END){
+            closed = (--depth == 0);
+        }
+        Token t = lexer.next();
+        last_token_end = lexer.getOffset(t) + t.getValue().size();
+    }
+    if (!closed){
+        return;
+    }
+    for (TokenType type: {TokenType::IDENTIFER, TokenType::SEMICOLON}){
+        if (lexer.hasNext() && lexer.peek().getType() == type){
+            Token t = lexer.next();
+            last_token_end = lexer.getOffset(t) + t.getValue().size();
+        }
+    }
+}
+
+FlatTree& Parser::returnFinalFlatTree(){
+    flat->finish();
+    return *flat;
+}
+
+int Parser::getMaxStatementDepth(){
+    return max_statement_depth;
+}
+
+int Parser::getMaxExpressionDepth(){
+    return max_expression_depth;
+}
+
+size_t Parser::getMaxStackDepth(){
+    return max_stack_depth;
+}
+
+// Parses a whole program, recovering from syntax errors where possible. 
+// The errors are available from getDiagnostics(). If one could not be recovered from, 
+// whatever was built up to that point is placed under a "program" node as a partial tree.
+// Returns the number of tree nodes pushed to stack
+int Parser::parseWinzig(){
+    uint32_t start = nodeStart();
+    try {
+        return parseProgram();
+    }
+    catch (const SyntaxError& err){
+        recordError(err);
+        buildTree(TreeNodeType::PROGRAM, num_roots, start);
+        return 1;
+    }
 }
 
 // Parses the production
 // Winzig -> 'program' Name ':' Consts Types Dclns SubProgs Body Name '.' => "program"
 // Returns the number of tree nodes pushed to stack
-int Parser::parseWinzig(){
+int Parser::parseProgram(){
+    uint32_t start = nodeStart();
     int tn = 0;
     readExpectedToken(TokenType::PROGRAM);
     tn += parseName();
@@ -116,7 +300,7 @@ int Parser::parseWinzig(){
     tn += parseBody();
     tn += parseName();
     readExpectedToken(TokenType::PERIOD); 
-    buildTree(TreeNodeType::PROGRAM, tn); 
+    buildTree(TreeNodeType::PROGRAM, tn, start); 
     return 1;  
 }
 
@@ -125,8 +309,9 @@ int Parser::parseWinzig(){
 //        ->                            => "consts";
 // Returns the number of tree nodes pushed to stack
 int Parser::parseConsts(){
+    uint32_t start = nodeStart();
     if (peekNextToken().getType() != TokenType::CONST){
-        buildTree(TreeNodeType::CONSTS, 0);
+        buildTree(TreeNodeType::CONSTS, 0, start);
         return 1;
     }
     else {
@@ -138,7 +323,7 @@ int Parser::parseConsts(){
             tn += parseConst();
         }
         readExpectedToken(TokenType::SEMICOLON);
-        buildTree(TreeNodeType::CONSTS, tn);
+        buildTree(TreeNodeType::CONSTS, tn, start);
         return 1;
     }
 }
@@ -147,12 +332,19 @@ int Parser::parseConsts(){
 // Const -> Name '=' ConstValue => "const"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseConst(){
-    int tn = 0;
-    tn += parseName();
-    readExpectedToken(TokenType::EQ);
-    tn += parseConstValue();
-    buildTree(TreeNodeType::CONST, tn);
-    return 1;
+    uint32_t start = nodeStart();
+    size_t mark = treeMark();
+    try {
+        int tn = 0;
+        tn += parseName();
+        readExpectedToken(TokenType::EQ);
+        tn += parseConstValue();
+        buildTree(TreeNodeType::CONST, tn, start);
+        return 1;
+    }
+    catch (const SyntaxError& err){
+        return recover(err, mark, start, Grammar::SYNC_TOKENS);
+    }
 }
 
 // Parses the productions
@@ -181,6 +373,7 @@ int Parser::parseConstValue(){
 //       ->                    => "types";
 // Returns the number of tree nodes pushed to stack
 int Parser::parseTypes(){
+    uint32_t start = nodeStart();
     if (peekNextToken().getType() == TokenType::TYPE){
         int tn = 0;
         readExpectedToken(TokenType::TYPE);
@@ -193,11 +386,11 @@ int Parser::parseTypes(){
             readExpectedToken(TokenType::SEMICOLON);
         }
 
-        buildTree(TreeNodeType::TYPES, tn);
+        buildTree(TreeNodeType::TYPES, tn, start);
         return 1;
     }
     else {
-        buildTree(TreeNodeType::TYPES, 0);
+        buildTree(TreeNodeType::TYPES, 0, start);
         return 1;
     }
 }
@@ -206,18 +399,26 @@ int Parser::parseTypes(){
 // Type -> Name '=' LitList => "type"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseType(){
-    int tn = 0;
-    tn += parseName();
-    readExpectedToken(TokenType::EQ);
-    tn += parseLitList();
-    buildTree(TreeNodeType::TYPE, tn);
-    return 1;
+    uint32_t start = nodeStart();
+    size_t mark = treeMark();
+    try {
+        int tn = 0;
+        tn += parseName();
+        readExpectedToken(TokenType::EQ);
+        tn += parseLitList();
+        buildTree(TreeNodeType::TYPE, tn, start);
+        return 1;
+    }
+    catch (const SyntaxError& err){
+        return recover(err, mark, start, Grammar::SYNC_TOKENS);
+    }
 }
 
 // Parses the production
 // LitList -> '(' Name list ',' ')' => "lit"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseLitList(){
+    uint32_t start = nodeStart();
     int tn = 0;
     readExpectedToken(TokenType::OPENBRKT);
     tn += parseName();
@@ -227,7 +428,7 @@ int Parser::parseLitList(){
         tn += parseName();
     }
     readExpectedToken(TokenType::CLSBRKT);
-    buildTree(TreeNodeType::LIT, tn);
+    buildTree(TreeNodeType::LIT, tn, start);
     return 1;
 }
 
@@ -235,11 +436,12 @@ int Parser::parseLitList(){
 // SubProgs -> Fcn* => "subprogs"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseSubProgs(){
+    uint32_t start = nodeStart();
     int tn = 0;
     while (peekNextToken().getType()==TokenType::FUNCTION){
         tn += parseFcn();
     }
-    buildTree(TreeNodeType::SUBPROGS, tn);
+    buildTree(TreeNodeType::SUBPROGS, tn, start);
     return 1;
 }
 
@@ -247,36 +449,53 @@ int Parser::parseSubProgs(){
 // Fcn -> 'function' Name '(' Params ')' ':' Name ';' Consts Types Dclns Body Name ';' => "fcn"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseFcn(){
-    int tn = 0;
-    readExpectedToken(TokenType::FUNCTION);
-    tn += parseName();
-    readExpectedToken(TokenType::OPENBRKT);
-    tn += parseParams();
-    readExpectedToken(TokenType::CLSBRKT);
-    readExpectedToken(TokenType::COLON);
-    tn += parseName();
-    readExpectedToken(TokenType::SEMICOLON);
-    tn += parseConsts();
-    tn += parseTypes();
-    tn += parseDclns();
-    tn += parseBody();
-    tn += parseName();
-    readExpectedToken(TokenType::SEMICOLON);
-    buildTree(TreeNodeType::FCN, tn);
-    return 1;
+    uint32_t start = nodeStart();
+    size_t mark = treeMark();
+    // How far the function got: before its body, in it, or past it
+    enum { BEFORE_BODY, IN_BODY, AFTER_BODY } reached = BEFORE_BODY;
+    try {
+        int tn = 0;
+        readExpectedToken(TokenType::FUNCTION);
+        tn += parseName();
+        readExpectedToken(TokenType::OPENBRKT);
+        tn += parseParams();
+        readExpectedToken(TokenType::CLSBRKT);
+        readExpectedToken(TokenType::COLON);
+        tn += parseName();
+        readExpectedToken(TokenType::SEMICOLON);
+        tn += parseConsts();
+        tn += parseTypes();
+        tn += parseDclns();
+        reached = IN_BODY;
+        tn += parseBody();
+        reached = AFTER_BODY;
+        tn += parseName();
+        readExpectedToken(TokenType::SEMICOLON);
+        buildTree(TreeNodeType::FCN, tn, start);
+        return 1;
+    }
+    catch (const SyntaxError& err){
+        // Give up on the rest of the function. Unless past its body, skip through the body first,
+        // so that its 'begin' is not taken for the program's body
+        if (reached != AFTER_BODY){
+            skipFunction(reached == IN_BODY ? 1 : 0);
+        }
+        return recover(err, mark, start, Grammar::FCN_SYNC_TOKENS);
+    }
 }
 
 // Parses the production
 // Params -> Dcln list ';' => "params"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseParams(){
+    uint32_t start = nodeStart();
     int tn = 0;
-    tn += parseDcln();
+    tn += parseDcln(Grammar::PARAM_SYNC_TOKENS);
     while (peekNextToken().getType() == TokenType::SEMICOLON){
         readExpectedToken(TokenType::SEMICOLON);
-        tn += parseDcln();
+        tn += parseDcln(Grammar::PARAM_SYNC_TOKENS);
     }
-    buildTree(TreeNodeType::PARAMS, tn);
+    buildTree(TreeNodeType::PARAMS, tn, start);
     return 1;
 }
 
@@ -285,46 +504,56 @@ int Parser::parseParams(){
 //       ->                   => "dclns"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseDclns(){
+    uint32_t start = nodeStart();
 
     if (peekNextToken().getType() == TokenType::VAR){
         int tn = 0;
         readExpectedToken(TokenType::VAR);
-        tn += parseDcln();
+        tn += parseDcln(Grammar::SYNC_TOKENS);
         readExpectedToken(TokenType::SEMICOLON);
 
         while (peekNextToken().getType() == TokenType::IDENTIFER){
-            tn += parseDcln();
+            tn += parseDcln(Grammar::SYNC_TOKENS);
             readExpectedToken(TokenType::SEMICOLON);
         }
-        buildTree(TreeNodeType::DCLNS, tn);
+        buildTree(TreeNodeType::DCLNS, tn, start);
         return 1;
     }
     else {
-        buildTree(TreeNodeType::DCLNS, 0);
+        buildTree(TreeNodeType::DCLNS, 0, start);
         return 1;
     }
 }
 
 // Parses the production
 // Dcln -> Name list ',' ':' Name => "var";
+// A failed declaration is skipped up to one of the sync tokens, which differ for params and vars
 // Returns the number of tree nodes pushed to stack
-int Parser::parseDcln(){
-    int tn = 0;
-    tn += parseName();
-    while (peekNextToken().getType() == TokenType::COMMA){
-        readExpectedToken(TokenType::COMMA);
+int Parser::parseDcln(TokenSet sync_tokens){
+    uint32_t start = nodeStart();
+    size_t mark = treeMark();
+    try {
+        int tn = 0;
         tn += parseName();
+        while (peekNextToken().getType() == TokenType::COMMA){
+            readExpectedToken(TokenType::COMMA);
+            tn += parseName();
+        }
+        readExpectedToken(TokenType::COLON);
+        tn += parseName();
+        buildTree(TreeNodeType::VAR, tn, start);
+        return 1;
+    }
+    catch (const SyntaxError& err){
+        return recover(err, mark, start, sync_tokens);
     }
-    readExpectedToken(TokenType::COLON);
-    tn += parseName();
-    buildTree(TreeNodeType::VAR, tn);
-    return 1;
 }
 
 // Parses the production
 // Body -> 'begin' Statement list ';' 'end' => "block";
 // Returns the number of tree nodes pushed to stack
 int Parser::parseBody(){
+    uint32_t start = nodeStart();
     int tn = 0;
     readExpectedToken(TokenType::BEGIN);
     tn += parseStatement();
@@ -334,7 +563,7 @@ int Parser::parseBody(){
         tn += parseStatement();
     }
     readExpectedToken(TokenType::END);
-    buildTree(TreeNodeType::BLOCK, tn);
+    buildTree(TreeNodeType::BLOCK, tn, start);
     return 1;
 }
 
@@ -354,127 +583,143 @@ int Parser::parseBody(){
 //           ->                              => "<null>"
 // Returns the number of tree nodes pushed to stack
 int Parser::parseStatement(){
+    NestingGuard nesting_guard (nesting, max_nesting);
+    DepthGuard guard (statement_depth, max_statement_depth);
+    uint32_t start = nodeStart();
 
-    int tn = 0;
-    switch (peekNextToken().getType()){
+    size_t mark = treeMark();
+    try {
+        int tn = 0;
+        switch (peekNextToken().getType()){
 
-        case TokenType::OUTPUT:
-            readExpectedToken(TokenType::OUTPUT);
-            readExpectedToken(TokenType::OPENBRKT);
-            tn += parseOutExp();
-            
-            while (peekNextToken().getType() == TokenType::COMMA){
-                readExpectedToken(TokenType::COMMA);
+            case TokenType::OUTPUT:
+                readExpectedToken(TokenType::OUTPUT);
+                readExpectedToken(TokenType::OPENBRKT);
                 tn += parseOutExp();
-            }
-            readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::OUTPUT, tn);
-            return 1;
-
-        case TokenType::IF:
-            readExpectedToken(TokenType::IF);
-            tn += parseExpression();
-            readExpectedToken(TokenType::THEN);
-            tn += parseStatement();
             
-            if (peekNextToken().getType() == TokenType::ELSE){
-                readExpectedToken(TokenType::ELSE);
+                while (peekNextToken().getType() == TokenType::COMMA){
+                    readExpectedToken(TokenType::COMMA);
+                    tn += parseOutExp();
+                }
+                readExpectedToken(TokenType::CLSBRKT);
+                buildTree(TreeNodeType::OUTPUT, tn, start);
+                return 1;
+
+            case TokenType::IF:
+                readExpectedToken(TokenType::IF);
+                tn += parseExpression();
+                readExpectedToken(TokenType::THEN);
                 tn += parseStatement();
-            }
-            buildTree(TreeNodeType::IF, tn);
-            return 1;
+            
+                if (peekNextToken().getType() == TokenType::ELSE){
+                    readExpectedToken(TokenType::ELSE);
+                    tn += parseStatement();
+                }
+                buildTree(TreeNodeType::IF, tn, start);
+                return 1;
 
-        case TokenType::WHILE:
-            readExpectedToken(TokenType::WHILE);
-            tn += parseExpression();
-            readExpectedToken(TokenType::DO);
-            tn += parseStatement();
-            buildTree(TreeNodeType::WHILE, tn);
-            return 1;
+            case TokenType::WHILE:
+                readExpectedToken(TokenType::WHILE);
+                tn += parseExpression();
+                readExpectedToken(TokenType::DO);
+                tn += parseStatement();
+                buildTree(TreeNodeType::WHILE, tn, start);
+                return 1;
         
-        case TokenType::REPEAT:
-            readExpectedToken(TokenType::REPEAT);
-            tn += parseStatement();
-            
-            while (peekNextToken().getType() == TokenType::SEMICOLON){
-                readExpectedToken(TokenType::SEMICOLON);
+            case TokenType::REPEAT:
+                readExpectedToken(TokenType::REPEAT);
                 tn += parseStatement();
-            }
-            readExpectedToken(TokenType::UNTIL);
-            tn += parseExpression();
-            buildTree(TreeNodeType::REPEAT, tn);
-            return 1;
-
-        case TokenType::FOR:
-            readExpectedToken(TokenType::FOR);
-            readExpectedToken(TokenType::OPENBRKT);
-            tn += parseForStat();
-            readExpectedToken(TokenType::SEMICOLON);
-            tn += parseForExp();
-            readExpectedToken(TokenType::SEMICOLON);
-            tn += parseForStat();
-            readExpectedToken(TokenType::CLSBRKT);
-            tn += parseStatement();
-            buildTree(TreeNodeType::FOR, tn);
-            return 1;
-
-        case TokenType::LOOP:
-            readExpectedToken(TokenType::LOOP);
-            tn += parseStatement();
             
-            while (peekNextToken().getType() == TokenType::SEMICOLON){
+                while (peekNextToken().getType() == TokenType::SEMICOLON){
+                    readExpectedToken(TokenType::SEMICOLON);
+                    tn += parseStatement();
+                }
+                readExpectedToken(TokenType::UNTIL);
+                tn += parseExpression();
+                buildTree(TreeNodeType::REPEAT, tn, start);
+                return 1;
+
+            case TokenType::FOR:
+                readExpectedToken(TokenType::FOR);
+                readExpectedToken(TokenType::OPENBRKT);
+                tn += parseForStat();
                 readExpectedToken(TokenType::SEMICOLON);
+                tn += parseForExp();
+                readExpectedToken(TokenType::SEMICOLON);
+                tn += parseForStat();
+                readExpectedToken(TokenType::CLSBRKT);
                 tn += parseStatement();
-            }
-            readExpectedToken(TokenType::POOL);
-            buildTree(TreeNodeType::LOOP, tn);
-            return 1;
+                buildTree(TreeNodeType::FOR, tn, start);
+                return 1;
 
-        case TokenType::CASE:
-            readExpectedToken(TokenType::CASE);
-            tn += parseExpression();
-            readExpectedToken(TokenType::OF);
-            tn += parseCaseclauses();
-            tn += parseOtherwiseClause();
-            readExpectedToken(TokenType::END);
-            buildTree(TreeNodeType::CASE, tn);
-            return 1;
+            case TokenType::LOOP:
+                readExpectedToken(TokenType::LOOP);
+                tn += parseStatement();
+            
+                while (peekNextToken().getType() == TokenType::SEMICOLON){
+                    readExpectedToken(TokenType::SEMICOLON);
+                    tn += parseStatement();
+                }
+                readExpectedToken(TokenType::POOL);
+                buildTree(TreeNodeType::LOOP, tn, start);
+                return 1;
 
-        case TokenType::READ:
-            readExpectedToken(TokenType::READ);
-            readExpectedToken(TokenType::OPENBRKT);
-            tn += parseName();
+            case TokenType::CASE:
+                readExpectedToken(TokenType::CASE);
+                tn += parseExpression();
+                readExpectedToken(TokenType::OF);
+                tn += parseCaseclauses();
+                tn += parseOtherwiseClause();
+                readExpectedToken(TokenType::END);
+                buildTree(TreeNodeType::CASE, tn, start);
+                return 1;
 
-            while (peekNextToken().getType() == TokenType::COMMA){
-                readExpectedToken(TokenType::COMMA);
+            case TokenType::READ:
+                readExpectedToken(TokenType::READ);
+                readExpectedToken(TokenType::OPENBRKT);
                 tn += parseName();
-            }
-            readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::READ, tn);
-            return 1;
 
-        case TokenType::EXIT:
-            readExpectedToken(TokenType::EXIT);
-            buildTree(TreeNodeType::EXIT, 0);
-            return 1;
+                while (peekNextToken().getType() == TokenType::COMMA){
+                    readExpectedToken(TokenType::COMMA);
+                    tn += parseName();
+                }
+                readExpectedToken(TokenType::CLSBRKT);
+                buildTree(TreeNodeType::READ, tn, start);
+                return 1;
 
-        case TokenType::RETURN:
-            readExpectedToken(TokenType::RETURN);
-            tn += parseExpression();
-            buildTree(TreeNodeType::RETURN, tn);
-            return 1;
+            case TokenType::EXIT:
+                readExpectedToken(TokenType::EXIT);
+                buildTree(TreeNodeType::EXIT, 0, start);
+                return 1;
 
-        case TokenType::IDENTIFER:
-            // All Assignment productions begin with this token
-            return parseAssignment();
+            case TokenType::RETURN:
+                readExpectedToken(TokenType::RETURN);
+                tn += parseExpression();
+                buildTree(TreeNodeType::RETURN, tn, start);
+                return 1;
 
-        case TokenType::BEGIN:
-            // All Body productions begin with this token
-            return parseBody();
+            case TokenType::IDENTIFER:
+                // All Assignment productions begin with this token
+                return parseAssignment();
 
-        default:
-            buildTree(TreeNodeType::NNULL, 0);
-            return 1;
+            case TokenType::BEGIN:
+                // All Body productions begin with this token
+                return parseBody();
+
+            default:
+                // An empty statement, which must still be followed by something that can follow a statement
+                if (!Grammar::STATEMENT_FOLLOW.contains(peekNextToken().getType())){
+                    throw SyntaxError(
+                        "Expected a statement, got " + Token::describe(peekNextToken().getType()),
+                        lexer.getOffset(peekNextToken())
+                    );
+                }
+                buildTree(TreeNodeType::NNULL, 0, start);
+                return 1;
+        }
+    }
+    catch (const SyntaxError& err){
+        return recover(err, mark, start, Grammar::SYNC_TOKENS);
     }
 }
 
@@ -483,14 +728,15 @@ int Parser::parseStatement(){
 //        -> StringNode => "string";
 // Returns the number of tree nodes pushed to stack
 int Parser::parseOutExp(){
+    uint32_t start = nodeStart();
     if (peekNextToken().getType() == TokenType::STRING){
         int tn = parseStringNode();
-        buildTree(TreeNodeType::STRING, tn);
+        buildTree(TreeNodeType::STRING, tn, start);
         return 1;
     }
     else {
         int tn = parseExpression();
-        buildTree(TreeNodeType::TN_INTEGER, tn);
+        buildTree(TreeNodeType::TN_INTEGER, tn, start);
         return 1;
     }
 }
@@ -510,9 +756,8 @@ int Parser::parseCaseclauses(){
     int tn = 0;
     tn += parseCaseclause();
     readExpectedToken(TokenType::SEMICOLON);
-    
-    std::unordered_set<TokenType> select_set = {TokenType::INTEGER, TokenType::IDENTIFER, TokenType::CHAR};
-    while (select_set.count(peekNextToken().getType())){
+
+    while (Grammar::CASECLAUSE_FIRST.contains(peekNextToken().getType())){
         tn += parseCaseclause();
         readExpectedToken(TokenType::SEMICOLON);
     }
@@ -523,6 +768,7 @@ int Parser::parseCaseclauses(){
 // Caseclause -> CaseExpression list ',' ':' Statement => "case_clause"
 // Returns the number of tree nodes added to the stack
 int Parser::parseCaseclause(){
+    uint32_t start = nodeStart();
     int tn = 0;
     tn += parseCaseExpression();
 
@@ -532,7 +778,7 @@ int Parser::parseCaseclause(){
     }
     readExpectedToken(TokenType::COLON);
     tn += parseStatement();
-    buildTree(TreeNodeType::CASECLAUSE, tn);
+    buildTree(TreeNodeType::CASECLAUSE, tn, start);
     return 1;
 }
 
@@ -541,11 +787,12 @@ int Parser::parseCaseclause(){
 //                -> ConstValue '..' ConstValue => ".."
 // Returns the number of tree nodes added to the stack
 int Parser::parseCaseExpression(){
+    uint32_t start = nodeStart();
     int tn = parseConstValue();
     if (peekNextToken().getType() == TokenType::DOTS){
         readExpectedToken(TokenType::DOTS);
         tn += parseConstValue();
-        buildTree(TreeNodeType::DOTS, tn);
+        buildTree(TreeNodeType::DOTS, tn, start);
         return 1;
     }
     else {
@@ -558,10 +805,11 @@ int Parser::parseCaseExpression(){
 //                 -> 
 // Returns the number of tree nodes added to the stack
 int Parser::parseOtherwiseClause(){
+    uint32_t start = nodeStart();
     if (peekNextToken().getType() == TokenType::OTHERWISE){
         readExpectedToken(TokenType::OTHERWISE);
         int tn = parseStatement();
-        buildTree(TreeNodeType::OTHERWISE, tn);
+        buildTree(TreeNodeType::OTHERWISE, tn, start);
         return 1;
     }
     else {
@@ -574,17 +822,18 @@ int Parser::parseOtherwiseClause(){
 //            -> Name ':=:' Name      => "swap"
 // Returns the number of tree nodes added to the stack
 int Parser::parseAssignment(){
+    uint32_t start = nodeStart();
     int tn = parseName();
     if (peekNextToken().getType() == TokenType::ASSIGN){
         readExpectedToken(TokenType::ASSIGN);
         tn += parseExpression();
-        buildTree(TreeNodeType::ASSIGN, tn);
+        buildTree(TreeNodeType::ASSIGN, tn, start);
         return 1;
     }
     else {
         readExpectedToken(TokenType::SWAP);
         tn += parseName();
-        buildTree(TreeNodeType::SWAP, tn);
+        buildTree(TreeNodeType::SWAP, tn, start);
         return 1;
     }
 }
@@ -594,12 +843,13 @@ int Parser::parseAssignment(){
 //         ->             => "<null>"
 // Returns the number of tree nodes added to the stack
 int Parser::parseForStat(){
-    // Select set of Assignment is { Identifier }
-    if (peekNextToken().getType() == TokenType::IDENTIFER){
+    uint32_t start = nodeStart();
+    // Select set of Assignment is FIRST(Name)
+    if (Grammar::NAME_FIRST.contains(peekNextToken().getType())){
         return parseAssignment();
     }
     else{
-        buildTree(TreeNodeType::NNULL, 0);
+        buildTree(TreeNodeType::NNULL, 0, start);
         return 1;
     }
 }
@@ -609,17 +859,12 @@ int Parser::parseForStat(){
 //        ->              => "true"
 // Returns the number of tree nodes added to the stack
 int Parser::parseForExp(){
-    std::unordered_set<TokenType> select_set = {
-        TokenType::MINUS, TokenType::PLUS, TokenType::NOT, TokenType::EOFT, TokenType::IDENTIFER,
-        TokenType::INTEGER, TokenType::CHAR, TokenType::OPENBRKT, 
-        TokenType::SUCC, TokenType::PRED, TokenType::CHR, TokenType::ORD
-    };
-
-    if (select_set.count(peekNextToken().getType())){
+    uint32_t start = nodeStart();
+    if (Grammar::EXPRESSION_FIRST.contains(peekNextToken().getType())){
         return parseExpression();
     }
     else {
-        buildTree(TreeNodeType::TRUE, 0);
+        buildTree(TreeNodeType::TRUE, 0, start);
         return 1;
     }
 }
@@ -632,146 +877,47 @@ int Parser::parseForExp(){
 //            -> Term '>' Term   => ">"
 //            -> Term '=' Term   => "="
 //            -> Term '<>' Term  => "<>"
+// Term       -> Factor
+//            -> Term '+' Factor  => "+"
+//            -> Term '-' Factor  => "-"
+//            -> Term 'or' Factor => "or"
+// Factor     -> Factor '*' Primary    => "*"
+//            -> Factor '/' Primary    => "/"
+//            -> Factor 'and' Primary  => "and"
+//            -> Factor 'mod' Primary  => "mod"
+//            -> Primary
+// by precedence climbing over Grammar::BINARY_OPERATORS
 // Returns the number of tree nodes added to the stack
 int Parser::parseExpression(){
-    int tn = parseTerm();
-    switch (peekNextToken().getType()){
-
-        case TokenType::LEQ:
-            readExpectedToken(TokenType::LEQ);
-            tn += parseTerm();
-            buildTree(TreeNodeType::LEQ, tn);
-            return 1;
-            break;
-
-        case TokenType::LE:
-            readExpectedToken(TokenType::LE);
-            tn += parseTerm();
-            buildTree(TreeNodeType::LE, tn);
-            return 1;
-            break;
-
-        case TokenType::GEQ:
-            readExpectedToken(TokenType::GEQ);
-            tn += parseTerm();
-            buildTree(TreeNodeType::GEQ, tn);
-            return 1;
-            break;
-
-        case TokenType::GE:
-            readExpectedToken(TokenType::GE);
-            tn += parseTerm();
-            buildTree(TreeNodeType::GE, tn);
-            return 1;
-            break;
-
-        case TokenType::EQ:
-            readExpectedToken(TokenType::EQ);
-            tn += parseTerm();
-            buildTree(TreeNodeType::EQ, tn);
-            return 1;
-            break;
-
-        case TokenType::NEQ:
-            readExpectedToken(TokenType::NEQ);
-            tn += parseTerm();
-            buildTree(TreeNodeType::NEQ, tn);
-            return 1;
-            break;
-
-        default:
-            // Just the Term on its own
-            return tn;
-            break;
-    }
-
+    NestingGuard nesting_guard (nesting, max_nesting);
+    DepthGuard guard (expression_depth, max_expression_depth);
+    return parseBinaryOperators(Grammar::RELATIONAL_PRECEDENCE);
 }
 
-// Parses the productions
-// Term -> Factor
-//      -> Term '+' Factor  => "+"
-//      -> Term '-' Factor  => "-"
-//      -> Term 'or' Factor => "or"
+// Parses a Primary followed by any binary operators binding at least as tightly as min_precedence.
+// Operands of an operator are parsed at one level tighter than it, which makes the operator
+// left associative. Relational operators are also non associative, so at most one is consumed.
 // Returns the number of tree nodes added to the stack
-int Parser::parseTerm(){
-    int tn = parseFactor();
-    std::unordered_set<TokenType> next_set = { TokenType::PLUS, TokenType::MINUS, TokenType::OR};
-    
-    while (next_set.count(peekNextToken().getType())){
-        int p = 0;
-        switch (peekNextToken().getType()){
-
-            case TokenType::PLUS:
-                readExpectedToken(TokenType::PLUS);
-                p = parseFactor();
-                buildTree(TreeNodeType::PLUS, tn+p);
-                break;
-
-            case TokenType::MINUS:
-                readExpectedToken(TokenType::MINUS);
-                p = parseFactor();
-                buildTree(TreeNodeType::MINUS, tn+p);
-                break;    
+int Parser::parseBinaryOperators(int min_precedence){
+    uint32_t start = nodeStart();
+    int tn = parsePrimary();
 
-            case TokenType::OR:
-                readExpectedToken(TokenType::OR);
-                p = parseFactor();
-                buildTree(TreeNodeType::OR, tn+p);
-                break; 
+    while (true){
+        TokenType type = peekNextToken().getType();
+        const Grammar::BinaryOperator& op = Grammar::BINARY_OPERATORS[static_cast<int>(type)];
 
-            default:
-                // This shouldn't happen
-                throw std::runtime_error("Error occurred when parsing Term");
+        if (op.precedence == 0 || op.precedence < min_precedence){
+            return tn;
         }
-    }
-    return 1;
-}
+        readExpectedToken(type);
+        tn += parseBinaryOperators(op.precedence + 1);
+        buildTree(op.node_type, tn, start);
+        tn = 1;
 
-// Parses the productions
-// Factor  -> Factor '*' Primary     => "*"
-//         -> Factor '/' Primary    => "/"
-//         -> Factor 'and' Primary  => "and"
-//         -> Factor 'mod' Primary  => "mod"
-//         -> Primary
-// Returns the number of tree nodes added to the stack
-int Parser::parseFactor(){
-    int tn = parsePrimary();
-    std::unordered_set<TokenType> next_set = { TokenType::MULT, TokenType::DIVIDE, TokenType::AND, TokenType::MOD};
-    
-    while (next_set.count(peekNextToken().getType())){
-        int p = 0;
-        switch (peekNextToken().getType()){
-
-            case TokenType::MULT:
-                readExpectedToken(TokenType::MULT);
-                p = parsePrimary();
-                buildTree(TreeNodeType::MULT, tn+p);
-                break;
-
-            case TokenType::DIVIDE:
-                readExpectedToken(TokenType::DIVIDE);
-                p = parsePrimary();
-                buildTree(TreeNodeType::DIVIDE, tn+p);
-                break;    
-
-            case TokenType::AND:
-                readExpectedToken(TokenType::AND);
-                p = parsePrimary();
-                buildTree(TreeNodeType::AND, tn+p);
-                break;     
-
-            case TokenType::MOD:
-                readExpectedToken(TokenType::MOD);
-                p = parsePrimary();
-                buildTree(TreeNodeType::MOD, tn+p);
-                break; 
-
-            default:
-                // This shouldn't happen
-                throw std::runtime_error("Error occurred when parsing Factor");
+        if (op.precedence == Grammar::RELATIONAL_PRECEDENCE){
+            return tn;
         }
     }
-    return 1;
 }
 
 // Parses the productions
@@ -790,6 +936,8 @@ int Parser::parseFactor(){
 //         -> 'ord' '(' Expression ')'  => "ord"
 // Returns the number of tree nodes added to the stack
 int Parser::parsePrimary(){
+    NestingGuard nesting_guard (nesting, max_nesting);
+    uint32_t start = nodeStart();
     int tn = 0;
 
     switch (peekNextToken().getType()){
@@ -797,7 +945,7 @@ int Parser::parsePrimary(){
         case TokenType::MINUS:
             readExpectedToken(TokenType::MINUS);
             tn += parsePrimary();
-            buildTree(TreeNodeType::MINUS, tn);
+            buildTree(TreeNodeType::MINUS, tn, start);
             return 1;
 
         case TokenType::PLUS:
@@ -807,12 +955,12 @@ int Parser::parsePrimary(){
         case TokenType::NOT:
             readExpectedToken(TokenType::NOT);
             tn += parsePrimary();
-            buildTree(TreeNodeType::NOT, tn);
+            buildTree(TreeNodeType::NOT, tn, start);
             return 1;
 
         case TokenType::EOFT:
             readExpectedToken(TokenType::EOFT);
-            buildTree(TreeNodeType::EOFT, 0);
+            buildTree(TreeNodeType::EOFT, 0, start);
             return 1;
 
         case TokenType::IDENTIFER:
@@ -827,7 +975,7 @@ int Parser::parsePrimary(){
                     tn += parseExpression();
                 }
                 readExpectedToken(TokenType::CLSBRKT);
-                buildTree(TreeNodeType::CALL, tn);
+                buildTree(TreeNodeType::CALL, tn, start);
                 return 1;
             }
             else {
@@ -853,7 +1001,7 @@ int Parser::parsePrimary(){
             readExpectedToken(TokenType::OPENBRKT);
             tn += parseExpression();
             readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::SUCC, tn);
+            buildTree(TreeNodeType::SUCC, tn, start);
             return 1;
 
         case TokenType::PRED:
@@ -861,7 +1009,7 @@ int Parser::parsePrimary(){
             readExpectedToken(TokenType::OPENBRKT);
             tn += parseExpression();
             readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::PRED, tn);
+            buildTree(TreeNodeType::PRED, tn, start);
             return 1;
 
         case TokenType::CHR:
@@ -869,7 +1017,7 @@ int Parser::parsePrimary(){
             readExpectedToken(TokenType::OPENBRKT);
             tn += parseExpression();
             readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::CHR, tn);
+            buildTree(TreeNodeType::CHR, tn, start);
             return 1;
 
         case TokenType::ORD:
@@ -877,11 +1025,14 @@ int Parser::parsePrimary(){
             readExpectedToken(TokenType::OPENBRKT);
             tn += parseExpression();
             readExpectedToken(TokenType::CLSBRKT);
-            buildTree(TreeNodeType::ORD, tn);
+            buildTree(TreeNodeType::ORD, tn, start);
             return 1;
 
         default:
-            throw std::runtime_error("Error occurred during parsing Primary");
+            throw SyntaxError(
+                "Expected an expression, got " + Token::describe(peekNextToken().getType()),
+                lexer.getOffset(peekNextToken())
+            );
     }
 }
 
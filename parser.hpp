@@ -1,17 +1,73 @@
+#ifndef PARSER_H
+#define PARSER_H
+
 #include <vector>
-#include <stack>
+#include <string>
+#include <stdexcept>
 #include "token.hpp"
+#include "lex.hpp"
+#include "grammar.hpp"
 #include "treenode.hpp"
+#include "flattree.hpp"
+
+// Error in the syntax of the program, found at a byte offset in the source
+class SyntaxError : public std::runtime_error {
+    public:
+        size_t offset;
+        SyntaxError(const std::string& message, size_t offset);
+};
+
+// Syntax error reported by the parser, with its position in the source
+struct Diagnostic {
+    SourceLocation location;
+    std::string message;
+};
 
 class Parser {
 
     private:
-        std::vector<Token> tokens;
-        std::vector<Token>::iterator position;
-        std::stack<TreeNode*> stack;
+        Lexer& lexer;
+        // Roots of the subtrees built so far, kept contiguous so that the children of a new node
+        // can be taken from the top as one slice
+        std::vector<TreeNode*> stack;
+        // Exactly one of these is set, depending on the tree layout being built
+        TreeArena* arena;
+        FlatTree* flat;
+        // Symbols of the token values, owned by the arena or flat tree
+        Interner* symbols;
+
+        // Number of subtrees built so far which are not yet children of another, in either layout
+        size_t num_roots;
+
+        // Current and deepest recursion of parseStatement / parseExpression, and the deepest stack
+        int statement_depth;
+        int expression_depth;
+        int max_statement_depth;
+        int max_expression_depth;
+        size_t max_stack_depth;
+
+        // Current nesting of the recursive productions (Statement, Expression and Primary), 
+        // and the limit beyond which parsing fails instead of risking a stack overflow
+        int nesting;
+        int max_nesting;
+
+        // End offset of the last token consumed, which is where the node being built ends
+        uint32_t last_token_end;
+
+        // Syntax errors found so far, and the offset of the last one
+        std::vector<Diagnostic> diagnostics;
+        size_t last_error_offset;
+
+        Parser(Lexer& lexer, TreeArena* arena, FlatTree* flat);
 
     public:
-        Parser(std::vector<Token> tokens);
+        static const int DEFAULT_MAX_NESTING = 10000;
+        // Must be bumped whenever the trees built for a program change, so that trees cached
+        // by an earlier version are not used
+        static const int VERSION = 1;
+
+        Parser(Lexer& lexer, TreeArena& arena);
+        Parser(Lexer& lexer, FlatTree& flat);
 
         bool positionValid();
         Token peekNextToken();
@@ -19,14 +75,32 @@ class Parser {
         void readToken();
         void readExpectedToken(TokenType type);
 
-        void buildTree(TreeNodeType type, int num_children);
+        uint32_t nodeStart();
+        void pushLeaf(TreeNodeType type, const Token& token);
+        void buildTree(TreeNodeType type, int num_children, uint32_t start);
         TreeNode* returnFinalTree();
+        FlatTree& returnFinalFlatTree();
+
+        void setMaxNesting(int max_nesting);
+
+        // Error recovery: the tree is rewound to a mark taken before a production,
+        // and the failed production is replaced by a single "<null>" node
+        void recordError(const SyntaxError& err);
+        const std::vector<Diagnostic>& getDiagnostics();
+        size_t treeMark();
+        int recover(const SyntaxError& err, size_t mark, uint32_t start, TokenSet sync_tokens);
+        void skipFunction(int depth);
+
+        int getMaxStatementDepth();
+        int getMaxExpressionDepth();
+        size_t getMaxStackDepth();
 
         // Functions which parse different types of nonterminals and return the number of tree nodes pushed onto the stack
         // Most often, the return value is 1
         // But a few nonterminals (CaseClauses, OtherwiseClause etc) do not always adhere to this
 
         int parseWinzig();
+        int parseProgram();
         int parseConsts();
         int parseConst();
         int parseConstValue();
@@ -37,7 +111,7 @@ class Parser {
         int parseFcn();
         int parseParams();
         int parseDclns();
-        int parseDcln();
+        int parseDcln(TokenSet sync_tokens);
         int parseBody();
         int parseStatement();
         int parseOutExp();
@@ -50,8 +124,9 @@ class Parser {
         int parseForStat();
         int parseForExp();
         int parseExpression();
-        int parseTerm();
-        int parseFactor();
+        int parseBinaryOperators(int min_precedence);
         int parsePrimary();
         int parseName();
-};
\ No newline at end of file
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "scan.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    constexpr std::array<uint8_t, 256> buildClasses(){
+        std::array<uint8_t, 256> classes = { };
+        for (int c=0; c<256; ++c){
+            bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            bool digit = c >= '0' && c <= '9';
+            if (c == ' ' || (c >= '\t' && c <= '\r')) classes[c] |= Scan::WHITESPACE;
+            if (letter)                                classes[c] |= Scan::LETTER;
+            if (digit)                                 classes[c] |= Scan::DIGIT;
+            if (letter || digit || c == '_')           classes[c] |= Scan::IDENTIFIER;
+        }
+        return classes;
+    }
+
+    size_t scalarRun(Scan::CharClass cls, const char* text, size_t length){
+        size_t i = 0;
+        while (i < length && (Scan::CLASSES[(unsigned char) text[i]] & cls)){
+            i++;
+        }
+        return i;
+    }
+
+#ifdef SCAN_X86
+
+    // A class of characters as up to four inclusive ranges of byte values, which is how the vector kernels test it
+    struct Ranges {
+        int count;
+        unsigned char low[4];
+        unsigned char high[4];
+    };
+
+    const Ranges WHITESPACE_RANGES = {2, {'\t', ' '}, {'\r', ' '}};
+    const Ranges LETTER_RANGES = {2, {'a', 'A'}, {'z', 'Z'}};
+    const Ranges DIGIT_RANGES = {1, {'0'}, {'9'}};
+    const Ranges IDENTIFIER_RANGES = {4, {'a', 'A', '0', '_'}, {'z', 'Z', '9', '_'}};
+
+    const Ranges& rangesOf(Scan::CharClass cls){
+        switch (cls){
+            case Scan::WHITESPACE:  return WHITESPACE_RANGES;
+            case Scan::LETTER:      return LETTER_RANGES;
+            case Scan::DIGIT:       return DIGIT_RANGES;
+            default:                return IDENTIFIER_RANGES;
+        }
+    }
+
+    // A byte c is in [low, high] when c - low (wrapping) is at most high - low, compared unsigned.
+    // SSE2 has no unsigned comparison, but x <= w exactly when min(x, w) == x
+
+    __attribute__((target("sse2")))
+    size_t sse2Run(Scan::CharClass cls, const char* text, size_t length){
+        const Ranges& ranges = rangesOf(cls);
+        size_t i = 0;
+        while (i + 16 <= length){
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            __m128i in_class = _mm_setzero_si128();
+            for (int r=0; r<ranges.count; ++r){
+                __m128i x = _mm_sub_epi8(bytes, _mm_set1_epi8(ranges.low[r]));
+                __m128i width = _mm_set1_epi8(ranges.high[r] - ranges.low[r]);
+                in_class = _mm_or_si128(in_class, _mm_cmpeq_epi8(_mm_min_epu8(x, width), x));
+            }
+            unsigned outside = ~_mm_movemask_epi8(in_class) & 0xffff;
+            if (outside){
+                return i + __builtin_ctz(outside);
+            }
+            i += 16;
+        }
+        return i + scalarRun(cls, text + i, length - i);
+    }
+
+    __attribute__((target("avx2")))
+    size_t avx2Run(Scan::CharClass cls, const char* text, size_t length){
+        const Ranges& ranges = rangesOf(cls);
+        size_t i = 0;
+        while (i + 32 <= length){
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+            __m256i in_class = _mm256_setzero_si256();
+            for (int r=0; r<ranges.count; ++r){
+                __m256i x = _mm256_sub_epi8(bytes, _mm256_set1_epi8(ranges.low[r]));
+                __m256i width = _mm256_set1_epi8(ranges.high[r] - ranges.low[r]);
+                in_class = _mm256_or_si256(in_class, _mm256_cmpeq_epi8(_mm256_min_epu8(x, width), x));
+            }
+            unsigned outside = ~(unsigned) _mm256_movemask_epi8(in_class);
+            if (outside){
+                return i + __builtin_ctz(outside);
+            }
+            i += 32;
+        }
+        return i + scalarRun(cls, text + i, length - i);
+    }
+
+#endif
+
+    struct Kernel {
+        size_t (*run)(Scan::CharClass, const char*, size_t);
+        const char* name;
+    };
+
+    Kernel selectKernel(){
+        const char* forced = getenv("WINZIG_SCAN");
+#ifdef SCAN_X86
+        __builtin_cpu_init();
+        bool has_avx2 = __builtin_cpu_supports("avx2");
+        bool has_sse2 = __builtin_cpu_supports("sse2");
+        if (forced && strcmp(forced, "sse2") == 0 && has_sse2){
+            return Kernel{sse2Run, "sse2"};
+        }
+        if (!forced || strcmp(forced, "scalar") != 0){
+            if (has_avx2){
+                return Kernel{avx2Run, "avx2"};
+            }
+            if (has_sse2){
+                return Kernel{sse2Run, "sse2"};
+            }
+        }
+#endif
+        (void) forced;
+        return Kernel{scalarRun, "scalar"};
+    }
+
+    const Kernel kernel = selectKernel();
+}
+
+// Built at compile time, so it is ready before any static initializer could scan
+constexpr std::array<uint8_t, 256> Scan::CLASSES = buildClasses();
+
+size_t Scan::longRun(CharClass cls, const char* text, size_t length){
+    return kernel.run(cls, text, length);
+}
+
+const char* Scan::implementation(){
+    return kernel.name;
+}
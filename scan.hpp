@@ -0,0 +1,65 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+// Measures runs of one class of characters, so that the Lexer can skip whitespace and read
+// identifiers and integers many bytes at a time instead of testing each byte.
+// Most runs in a program are short, so the first bytes are tested here, inline, with a lookup table.
+// Longer runs continue in a kernel which uses AVX2 (32 bytes at a time) or SSE2 (16 bytes at a time)
+// where the CPU supports it, and the table otherwise. The kernel is chosen once, at startup, and
+// can be forced with the WINZIG_SCAN environment variable ("avx2", "sse2" or "scalar").
+// Only the given length is ever read, so runs may end at the very end of a mapped file.
+namespace Scan {
+
+    enum CharClass : uint8_t {
+        WHITESPACE = 1,         // ' ', '\t', '\n', '\v', '\f', '\r'
+        LETTER = 2,             // a-z, A-Z
+        DIGIT = 4,              // 0-9
+        IDENTIFIER = 8,         // a-z, A-Z, 0-9, '_'
+    };
+
+    // The classes each byte value is in
+    extern const std::array<uint8_t, 256> CLASSES;
+
+    // Runs at least this long are continued by the kernel
+    const size_t SHORT_RUN = 16;
+
+    size_t longRun(CharClass cls, const char* text, size_t length);
+
+    // Returns the number of characters at the start of the text which are in the class
+    inline size_t run(CharClass cls, const char* text, size_t length){
+        size_t short_length = length < SHORT_RUN ? length : SHORT_RUN;
+        size_t i = 0;
+        while (i < short_length && (CLASSES[(unsigned char) text[i]] & cls)){
+            i++;
+        }
+        if (i < SHORT_RUN){
+            return i;
+        }
+        return i + longRun(cls, text + i, length - i);
+    }
+
+    inline size_t whitespaceRun(const char* text, size_t length){
+        return run(WHITESPACE, text, length);
+    }
+
+    inline size_t letterRun(const char* text, size_t length){
+        return run(LETTER, text, length);
+    }
+
+    inline size_t identifierRun(const char* text, size_t length){
+        return run(IDENTIFIER, text, length);
+    }
+
+    inline size_t digitRun(const char* text, size_t length){
+        return run(DIGIT, text, length);
+    }
+
+    // Name of the kernel in use
+    const char* implementation();
+}
+
+#endif
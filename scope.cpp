@@ -0,0 +1,71 @@
+#include "scope.hpp"
+#include "intern.hpp"
+
+// Empty slots hold NO_SYMBOL, which no name has
+Scope::Scope(const Scope* parent){
+    this->parent = parent;
+    this->log2_size = 4;
+    this->slots.assign(size_t(1) << log2_size, Slot{Interner::NO_SYMBOL, NOT_FOUND});
+    this->count = 0;
+}
+
+// Returns the slot holding the symbol, or the empty slot where it would go.
+// Symbols are numbered densely from 0, so they are spread over the table by Fibonacci hashing:
+// the top log2_size bits of the symbol times 2^32 / golden ratio. The low bits of the product
+// would only depend on the low bits of the symbol, so symbols equal modulo the size would collide
+size_t Scope::slotFor(uint32_t symbol) const {
+    size_t mask = slots.size() - 1;
+    size_t i = (uint32_t) (symbol * 2654435769u) >> (32 - log2_size);
+    while (slots[i].symbol != symbol && slots[i].symbol != Interner::NO_SYMBOL){
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Doubles the table, which is kept at most half full so that probe sequences stay short
+void Scope::grow(){
+    std::vector<Slot> old = std::move(slots);
+    log2_size++;
+    slots.assign(size_t(1) << log2_size, Slot{Interner::NO_SYMBOL, NOT_FOUND});
+    for (const Slot& slot: old){
+        if (slot.symbol != Interner::NO_SYMBOL){
+            slots[slotFor(slot.symbol)] = slot;
+        }
+    }
+}
+
+bool Scope::declare(uint32_t symbol, uint32_t declaration){
+    if (2 * (count + 1) > slots.size()){
+        grow();
+    }
+    size_t i = slotFor(symbol);
+    if (slots[i].symbol == symbol){
+        return false;
+    }
+    slots[i] = Slot{symbol, declaration};
+    count++;
+    return true;
+}
+
+uint32_t Scope::lookupLocal(uint32_t symbol) const {
+    return slots[slotFor(symbol)].declaration;
+}
+
+uint32_t Scope::lookup(uint32_t symbol) const {
+    for (const Scope* scope = this; scope; scope = scope->parent){
+        uint32_t declaration = scope->lookupLocal(symbol);
+        if (declaration != NOT_FOUND){
+            return declaration;
+        }
+    }
+    return NOT_FOUND;
+}
+
+const Scope* Scope::getParent() const {
+    return parent;
+}
+
+// Number of names declared in this scope
+size_t Scope::size() const {
+    return count;
+}
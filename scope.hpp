@@ -0,0 +1,47 @@
+#ifndef SCOPE_H
+#define SCOPE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// The names declared in one scope, mapping the symbol of each name (see Interner) to its declaration.
+// Held in a single open-addressed table with linear probing, so a lookup usually touches one cache line.
+// Scopes nest through their parent, which is searched when a name is not declared in the scope itself.
+// A scope which is no longer declared into may be shared between threads, as lookups do not modify it.
+class Scope {
+
+    private:
+        struct Slot {
+            uint32_t symbol;
+            uint32_t declaration;
+        };
+
+        const Scope* parent;
+        std::vector<Slot> slots;
+        // The table has 2^log2_size slots
+        int log2_size;
+        size_t count;
+
+        size_t slotFor(uint32_t symbol) const;
+        void grow();
+
+    public:
+        static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+        Scope(const Scope* parent);
+
+        // Returns false (and changes nothing) if the name is already declared in this scope
+        bool declare(uint32_t symbol, uint32_t declaration);
+
+        // Returns the declaration of the name in this scope only, or NOT_FOUND
+        uint32_t lookupLocal(uint32_t symbol) const;
+
+        // Returns the declaration of the name in the innermost scope declaring it, or NOT_FOUND
+        uint32_t lookup(uint32_t symbol) const;
+
+        const Scope* getParent() const;
+        size_t size() const;
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "semantic.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+SemanticAnalyzer::SemanticAnalyzer(const FlatTree& tree, Lexer& lexer, unsigned num_threads)
+    : tree(tree), lexer(lexer), predefined(nullptr), globals(&predefined) {
+    this->num_threads = num_threads;
+    this->global = Unit{false, { }, { }};
+    this->bindings = { };
+    this->diagnostics = { };
+    if (this->num_threads == 0){
+        this->num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+// Returns whether the node is an <identifier>, rather than the value leaf below one.
+// Its symbol is that of the value leaf, which is its only child
+bool SemanticAnalyzer::isName(uint32_t node){
+    return tree.getNode(node).type == TreeNodeType::IDENTIFER && tree.getNode(node).num_children == 1;
+}
+
+std::string SemanticAnalyzer::nameOf(uint32_t node){
+    return std::string(tree.getLabel(node + 1));
+}
+
+void SemanticAnalyzer::report(Unit& unit, uint32_t node, const std::string& message){
+    unit.problems.push_back(Problem{tree.getNode(node).source_start, message});
+}
+
+// Returns a declaration found from within the unit, which is either its own or a global one
+const Declaration& SemanticAnalyzer::declarationIn(Unit& unit, uint32_t declaration){
+    if (declaration & LOCAL){
+        return unit.declarations[declaration & ~LOCAL];
+    }
+    return global.declarations[declaration];
+}
+
+// Declares a predefined name in the global scope. A name the program never uses
+// has no symbol, and needs no declaration
+void SemanticAnalyzer::declarePredefined(DeclarationKind kind, const char* name){
+    uint32_t symbol = tree.getSymbols().find(name);
+    if (symbol == Interner::NO_SYMBOL){
+        return;
+    }
+    predefined.declare(symbol, global.declarations.size());
+    global.declarations.push_back(Declaration{kind, symbol, Declaration::NO_NODE, 0});
+}
+
+// Declares the name of an <identifier> node in the scope, unless it is already declared there
+void SemanticAnalyzer::declare(Unit& unit, Scope& scope, DeclarationKind kind, uint32_t node){
+    uint32_t symbol = tree.getNode(node + 1).value;
+    uint32_t declaration = unit.declarations.size() | (unit.local ? LOCAL : 0);
+    if (!scope.declare(symbol, declaration)){
+        report(unit, node, "Duplicate declaration of '" + nameOf(node) + "'");
+        return;
+    }
+    bindings[node] = declaration;
+    unit.declarations.push_back(Declaration{kind, symbol, node, 0});
+}
+
+// Binds an <identifier> node to the declaration of its name visible from the scope
+void SemanticAnalyzer::resolve(Unit& unit, const Scope& scope, uint32_t node){
+    uint32_t declaration = scope.lookup(tree.getNode(node + 1).value);
+    if (declaration == NO_DECLARATION){
+        report(unit, node, "Undeclared name '" + nameOf(node) + "'");
+        return;
+    }
+    bindings[node] = declaration;
+}
+
+// Binds every <identifier> in a subtree which declares nothing, such as a statement, and checks its calls.
+// Nodes are in pre-order, so the subtree is a single range to scan
+void SemanticAnalyzer::resolveAll(Unit& unit, const Scope& scope, uint32_t node){
+    for (uint32_t i=node; i<tree.getNode(node).end; ++i){
+        if (tree.getNode(i).type == TreeNodeType::CALL){
+            checkCall(unit, scope, i);
+        }
+        else if (isName(i)){
+            resolve(unit, scope, i);
+        }
+    }
+}
+
+// Call -> Name Expression+ ; the name must be a function taking that many arguments.
+// An undeclared name is reported when the scan reaches it
+void SemanticAnalyzer::checkCall(Unit& unit, const Scope& scope, uint32_t call){
+    uint32_t name = call + 1;
+    if (!isName(name)){
+        return;
+    }
+    uint32_t declaration = scope.lookup(tree.getNode(name + 1).value);
+    if (declaration == NO_DECLARATION){
+        return;
+    }
+    const Declaration& callee = declarationIn(unit, declaration);
+    uint32_t num_arguments = tree.getNode(call).num_children - 1;
+    if (callee.kind != DeclarationKind::FUNCTION){
+        report(unit, name, "'" + nameOf(name) + "' is not a function");
+    }
+    else if (callee.num_params != num_arguments){
+        report(unit, name, "'" + nameOf(name) + "' takes " + std::to_string(callee.num_params)
+                           + (callee.num_params == 1 ? " argument" : " arguments") + ", got " + std::to_string(num_arguments));
+    }
+}
+
+// Binds the name a function (or the program) ends with to what it started with, which it must match
+void SemanticAnalyzer::checkEndName(Unit& unit, uint32_t name, uint32_t end_name){
+    if (tree.getNode(name + 1).value != tree.getNode(end_name + 1).value){
+        report(unit, end_name, "Expected the name '" + nameOf(name) + "' at the end, got '" + nameOf(end_name) + "'");
+        return;
+    }
+    bindings[end_name] = bindings[name];
+}
+
+// Consts -> (Name ConstValue)* ; a const whose value is a name refers to an earlier const or literal
+void SemanticAnalyzer::analyzeConsts(Unit& unit, Scope& scope, uint32_t consts){
+    for (uint32_t c=consts+1; c<tree.getNode(consts).end; c=tree.getNode(c).end){
+        if (tree.getNode(c).type != TreeNodeType::CONST){
+            continue;
+        }
+        uint32_t name = c + 1;
+        uint32_t value = tree.getNode(name).end;
+        if (isName(value)){
+            resolve(unit, scope, value);
+        }
+        declare(unit, scope, DeclarationKind::CONSTANT, name);
+    }
+}
+
+// Types -> (Name LitList)* ; each literal is declared alongside its type
+void SemanticAnalyzer::analyzeTypes(Unit& unit, Scope& scope, uint32_t types){
+    for (uint32_t t=types+1; t<tree.getNode(types).end; t=tree.getNode(t).end){
+        if (tree.getNode(t).type != TreeNodeType::TYPE){
+            continue;
+        }
+        uint32_t name = t + 1;
+        declare(unit, scope, DeclarationKind::TYPE, name);
+
+        uint32_t lit = tree.getNode(name).end;
+        for (uint32_t l=lit+1; l<tree.getNode(lit).end; l=tree.getNode(l).end){
+            declare(unit, scope, DeclarationKind::LITERAL, l);
+        }
+    }
+}
+
+// Dclns (or Params) -> (Name+ TypeName)* ; the type name is looked up from type_scope,
+// unless that is null because it has been already
+void SemanticAnalyzer::analyzeDclns(Unit& unit, Scope& scope, uint32_t dclns, DeclarationKind kind, const Scope* type_scope){
+    for (uint32_t v=dclns+1; v<tree.getNode(dclns).end; v=tree.getNode(v).end){
+        if (tree.getNode(v).type != TreeNodeType::VAR){
+            continue;
+        }
+        uint32_t type_name = v + 1;
+        for (uint32_t n=v+1; n<tree.getNode(v).end; n=tree.getNode(n).end){
+            type_name = n;
+        }
+        if (type_scope){
+            resolve(unit, *type_scope, type_name);
+        }
+
+        for (uint32_t n=v+1; n<type_name; n=tree.getNode(n).end){
+            declare(unit, scope, kind, n);
+        }
+    }
+}
+
+// Finds the parts of a function, which has exactly these unless it is a partial tree:
+// Fcn -> Name Params TypeName Consts Types Dclns Body Name
+bool SemanticAnalyzer::functionParts(uint32_t fcn, uint32_t parts[FUNCTION_PARTS]){
+    if (tree.getNode(fcn).num_children != FUNCTION_PARTS){
+        return false;
+    }
+    uint32_t c = fcn + 1;
+    for (int i=0; i<FUNCTION_PARTS; ++i){
+        parts[i] = c;
+        c = tree.getNode(c).end;
+    }
+    return true;
+}
+
+// Declares a function in the global scope, with its signature (the types of its params and result)
+// resolved there too. Its params are only declared, in its own scope, by analyzeFunction
+void SemanticAnalyzer::declareFunction(uint32_t fcn){
+    uint32_t parts[FUNCTION_PARTS];
+    if (!functionParts(fcn, parts)){
+        return;
+    }
+    declare(global, globals, DeclarationKind::FUNCTION, parts[0]);
+
+    uint32_t num_params = 0;
+    for (uint32_t v=parts[1]+1; v<tree.getNode(parts[1]).end; v=tree.getNode(v).end){
+        if (tree.getNode(v).type == TreeNodeType::VAR){
+            num_params += tree.getNode(v).num_children - 1;
+            uint32_t type_name = v + 1;
+            for (uint32_t n=v+1; n<tree.getNode(v).end; n=tree.getNode(n).end){
+                type_name = n;
+            }
+            resolve(global, globals, type_name);
+        }
+    }
+    resolve(global, globals, parts[2]);
+
+    if (bindings[parts[0]] != NO_DECLARATION){
+        global.declarations[bindings[parts[0]]].num_params = num_params;
+    }
+}
+
+// Analyzes everything in a function but its signature, in a scope of its own
+void SemanticAnalyzer::analyzeFunction(Unit& unit, uint32_t fcn){
+    uint32_t parts[FUNCTION_PARTS];
+    if (!functionParts(fcn, parts)){
+        return;
+    }
+    Scope scope (&globals);
+    analyzeDclns(unit, scope, parts[1], DeclarationKind::PARAMETER, nullptr);
+    analyzeConsts(unit, scope, parts[3]);
+    analyzeTypes(unit, scope, parts[4]);
+    analyzeDclns(unit, scope, parts[5], DeclarationKind::VARIABLE, &scope);
+    resolveAll(unit, scope, parts[6]);
+    checkEndName(unit, parts[0], parts[7]);
+}
+
+// Runs the tasks on the pool of threads, each thread taking the next task until none are left
+void SemanticAnalyzer::runTasks(size_t num_tasks, const std::function<void(size_t)>& task){
+    std::atomic<size_t> next_task (0);
+    auto worker = [&](){
+        size_t i;
+        while ((i = next_task++) < num_tasks){
+            task(i);
+        }
+    };
+
+    size_t n = std::min<size_t>({num_threads, num_tasks, std::max<size_t>(1, tree.size() / MIN_NODES_PER_THREAD)});
+    std::vector<std::thread> threads = { };
+    for (size_t t=1; t<n; ++t){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t: threads){
+        t.join();
+    }
+}
+
+// Program -> Name Consts Types Dclns SubProgs Body Name
+// Every function is declared before any is analyzed, so that a function can call those after it
+void SemanticAnalyzer::analyze(){
+    bindings.assign(tree.size(), NO_DECLARATION);
+    if (tree.size() == 0 || tree.getNode(0).type != TreeNodeType::PROGRAM){
+        return;
+    }
+    declarePredefined(DeclarationKind::TYPE, "integer");
+    declarePredefined(DeclarationKind::TYPE, "char");
+    declarePredefined(DeclarationKind::TYPE, "boolean");
+    declarePredefined(DeclarationKind::LITERAL, "true");
+    declarePredefined(DeclarationKind::LITERAL, "false");
+    // An integer variable which the reference programs assign the results of functions called only
+    // for their effects to, as in "d:=Factor ( i )"
+    declarePredefined(DeclarationKind::VARIABLE, "d");
+
+    std::vector<uint32_t> names = { };
+    std::vector<uint32_t> functions = { };
+    uint32_t body = Declaration::NO_NODE;
+    for (uint32_t c=1; c<tree.getNode(0).end; c=tree.getNode(c).end){
+        switch (tree.getNode(c).type){
+            case TreeNodeType::CONSTS:
+                analyzeConsts(global, globals, c);
+                break;
+            case TreeNodeType::TYPES:
+                analyzeTypes(global, globals, c);
+                break;
+            case TreeNodeType::DCLNS:
+                analyzeDclns(global, globals, c, DeclarationKind::VARIABLE, &globals);
+                break;
+            case TreeNodeType::SUBPROGS:
+                for (uint32_t f=c+1; f<tree.getNode(c).end; f=tree.getNode(f).end){
+                    if (tree.getNode(f).type == TreeNodeType::FCN){
+                        declareFunction(f);
+                        functions.push_back(f);
+                    }
+                }
+                break;
+            case TreeNodeType::BLOCK:
+                body = c;
+                break;
+            case TreeNodeType::IDENTIFER:
+                names.push_back(c);
+                break;
+            default:
+                break;
+        }
+    }
+    // The program's name declares nothing, and only has to match at the end
+    if (names.size() == 2){
+        checkEndName(global, names[0], names[1]);
+    }
+
+    // Each function is a task, and the program's body is the last
+    std::vector<Unit> units (functions.size() + 1, Unit{true, { }, { }});
+    runTasks(units.size(), [&](size_t i){
+        if (i < functions.size()){
+            analyzeFunction(units[i], functions[i]);
+        }
+        else if (body != Declaration::NO_NODE){
+            resolveAll(units[i], globals, body);
+        }
+    });
+
+    // Each function's declarations follow the global ones, in the order of the functions
+    std::vector<uint32_t> bases (functions.size());
+    for (size_t i=0; i<functions.size(); ++i){
+        bases[i] = global.declarations.size();
+        global.declarations.insert(global.declarations.end(), units[i].declarations.begin(), units[i].declarations.end());
+    }
+    runTasks(functions.size(), [&](size_t i){
+        for (uint32_t node=functions[i]; node<tree.getNode(functions[i]).end; ++node){
+            if (bindings[node] != NO_DECLARATION && (bindings[node] & LOCAL)){
+                bindings[node] = bases[i] + (bindings[node] & ~LOCAL);
+            }
+        }
+    });
+
+    std::vector<Problem> problems = std::move(global.problems);
+    for (Unit& unit: units){
+        std::move(unit.problems.begin(), unit.problems.end(), std::back_inserter(problems));
+    }
+    std::stable_sort(problems.begin(), problems.end(), [](const Problem& a, const Problem& b){
+        return a.offset < b.offset;
+    });
+    for (const Problem& problem: problems){
+        diagnostics.push_back(Diagnostic{lexer.getLocation(problem.offset), problem.message});
+    }
+}
+
+const std::vector<Diagnostic>& SemanticAnalyzer::getDiagnostics(){
+    return diagnostics;
+}
+
+uint32_t SemanticAnalyzer::getBinding(uint32_t node){
+    return bindings[node];
+}
+
+const Declaration& SemanticAnalyzer::getDeclaration(uint32_t declaration){
+    return global.declarations[declaration];
+}
+
+// Number of declarations, including the predefined names the program uses
+size_t SemanticAnalyzer::getNumDeclarations(){
+    return global.declarations.size();
+}
@@ -0,0 +1,116 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include "flattree.hpp"
+#include "scope.hpp"
+#include "lex.hpp"
+#include "parser.hpp"
+
+enum class DeclarationKind {
+    TYPE, CONSTANT, LITERAL, VARIABLE, PARAMETER, FUNCTION
+};
+
+// A name introduced by the program (or predefined, as integer, char, boolean, true, false and d are)
+struct Declaration {
+    DeclarationKind kind;
+    uint32_t symbol;
+    uint32_t node;          // Index of the <identifier> node naming it, NO_NODE for predefined names
+    uint32_t num_params;    // Number of parameters, for functions
+
+    static const uint32_t NO_NODE = UINT32_MAX;
+};
+
+// Resolves the names of a parsed program: builds the global scope (consts, types, vars and functions)
+// and a scope for each function (params, consts, types and vars), and binds every <identifier> node
+// to the declaration it refers to. Reports names which are undeclared or declared twice in one scope,
+// calls to names which are not functions or with the wrong number of arguments, and functions or
+// the program ending with a different name than they started with.
+//
+// Works on a finished FlatTree, so that bindings are a side table indexed by node rather than
+// anything added to the nodes, and a function's statements are one contiguous range of nodes.
+// Names are compared by symbol, and each lookup is a probe of an open-addressed table,
+// so the pass takes linear time in the size of the tree.
+//
+// The global scope, and the signature of every function, are built first. They are then read-only,
+// so the functions (and the program's body) are analyzed concurrently, on a pool of threads.
+// Each keeps what it finds to itself until all are done, and the results are merged in the order
+// of the source, so the declarations and errors do not depend on how the work was scheduled.
+class SemanticAnalyzer {
+
+    private:
+        // An error found at a byte offset in the source, turned into a Diagnostic once the pass is done
+        struct Problem {
+            uint32_t offset;
+            std::string message;
+        };
+
+        // The declarations and errors found by one task. The global unit's declarations are numbered
+        // as they are. Those of a function are numbered with LOCAL set until they are merged
+        struct Unit {
+            bool local;
+            std::vector<Declaration> declarations;
+            std::vector<Problem> problems;
+        };
+
+        static const uint32_t LOCAL = 1u << 31;
+        static const int FUNCTION_PARTS = 8;
+
+        const FlatTree& tree;
+        Lexer& lexer;
+        unsigned num_threads;
+        // Predefined names are in a scope of their own around the global one, so that a program may redeclare them
+        Scope predefined;
+        Scope globals;
+        Unit global;
+
+        std::vector<uint32_t> bindings;
+        std::vector<Diagnostic> diagnostics;
+
+        bool isName(uint32_t node);
+        std::string nameOf(uint32_t node);
+        void report(Unit& unit, uint32_t node, const std::string& message);
+        const Declaration& declarationIn(Unit& unit, uint32_t declaration);
+
+        void declarePredefined(DeclarationKind kind, const char* name);
+        void declare(Unit& unit, Scope& scope, DeclarationKind kind, uint32_t node);
+        void resolve(Unit& unit, const Scope& scope, uint32_t node);
+        void resolveAll(Unit& unit, const Scope& scope, uint32_t node);
+        void checkCall(Unit& unit, const Scope& scope, uint32_t call);
+        void checkEndName(Unit& unit, uint32_t name, uint32_t end_name);
+
+        void analyzeConsts(Unit& unit, Scope& scope, uint32_t consts);
+        void analyzeTypes(Unit& unit, Scope& scope, uint32_t types);
+        void analyzeDclns(Unit& unit, Scope& scope, uint32_t dclns, DeclarationKind kind, const Scope* type_scope);
+        bool functionParts(uint32_t fcn, uint32_t parts[FUNCTION_PARTS]);
+        void declareFunction(uint32_t fcn);
+        void analyzeFunction(Unit& unit, uint32_t fcn);
+
+        void runTasks(size_t num_tasks, const std::function<void(size_t)>& task);
+
+    public:
+        static constexpr uint32_t NO_DECLARATION = Scope::NOT_FOUND;
+
+        // Trees smaller than this many nodes per thread are not worth another thread
+        static const size_t MIN_NODES_PER_THREAD = 16 * 1024;
+
+        // The tree must be finished, and parsed from the lexer's content without syntax errors
+        // (a tree with "<null>" nodes from error recovery is analyzed as far as it goes)
+        // num_threads of 0 uses one thread per hardware thread
+        SemanticAnalyzer(const FlatTree& tree, Lexer& lexer, unsigned num_threads);
+
+        void analyze();
+
+        // Errors, in the order they appear in the source
+        const std::vector<Diagnostic>& getDiagnostics();
+
+        // Declaration an <identifier> node refers to (or declares), NO_DECLARATION if none
+        uint32_t getBinding(uint32_t node);
+        const Declaration& getDeclaration(uint32_t declaration);
+        size_t getNumDeclarations();
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "source.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+SourceFile::SourceFile(const std::string& path){
+    this->mapped = false;
+
+    std::ifstream file (path, std::ios::binary | std::ios::ate);
+    if (!file){
+        throw std::runtime_error("Error: Could not read file. ");
+    }
+    // Read the whole file with a single call
+    size_t size = file.tellg();
+    if (size > MAX_SIZE){
+        throw std::runtime_error("Error: File is too large. ");
+    }
+    buffer.resize(size);
+    file.seekg(0);
+    file.read(&buffer[0], buffer.size());
+
+    this->data = buffer.data();
+    this->size = buffer.size();
+}
+
+SourceFile::~SourceFile(){ }
+
+#else
+
+SourceFile::SourceFile(const std::string& path){
+    this->data = nullptr;
+    this->size = 0;
+    this->mapped = false;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error("Error: Could not read file. ");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        close(fd);
+        throw std::runtime_error("Error: Could not read file. ");
+    }
+
+    if (S_ISREG(st.st_mode) && (size_t) st.st_size > MAX_SIZE){
+        close(fd);
+        throw std::runtime_error("Error: File is too large. ");
+    }
+
+    // Map regular, non-empty files directly. Anything else (pipes, empty files, 
+    // filesystems that don't support mmap) falls back to reading into the buffer
+    if (S_ISREG(st.st_mode) && st.st_size > 0){
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED){
+            madvise(addr, st.st_size, MADV_SEQUENTIAL);
+            this->data = static_cast<const char*>(addr);
+            this->size = st.st_size;
+            this->mapped = true;
+        }
+    }
+
+    if (!mapped){
+        try {
+            readWhole(fd, S_ISREG(st.st_mode) ? st.st_size : 0);
+        }
+        catch (...){
+            close(fd);
+            throw;
+        }
+    }
+    close(fd);
+}
+
+// Reads the rest of the file into the buffer, with a single read() when the size is known
+void SourceFile::readWhole(int fd, size_t size_hint){
+    // One spare byte lets the read that hits EOF return without growing the buffer
+    buffer.resize(size_hint > 0 ? size_hint + 1 : 65536);
+    size_t filled = 0;
+
+    while (true){
+        if (filled == buffer.size()){
+            buffer.resize(buffer.size() * 2);
+        }
+        ssize_t n = read(fd, &buffer[filled], buffer.size() - filled);
+        if (n < 0){
+            throw std::runtime_error("Error: Could not read file. ");
+        }
+        if (n == 0){
+            break;
+        }
+        filled += n;
+        if (filled > MAX_SIZE){
+            throw std::runtime_error("Error: File is too large. ");
+        }
+    }
+    buffer.resize(filled);
+
+    this->data = buffer.data();
+    this->size = buffer.size();
+}
+
+SourceFile::~SourceFile(){
+    if (mapped){
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+#endif
+
+std::string_view SourceFile::getContent() const {
+    return std::string_view(data, size);
+}
@@ -0,0 +1,34 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Read-only view of the content of a WinZigC source file.
+// The file is memory mapped where possible, otherwise it is read into a buffer in one go.
+// Tokens and tree nodes refer into this content, so it must outlive them.
+// Positions in the content are held as 32-bit offsets, which limits files to MAX_SIZE bytes.
+class SourceFile {
+
+    private:
+        const char* data;
+        size_t size;
+        bool mapped;
+        std::string buffer;
+
+        void readWhole(int fd, size_t size_hint);
+
+    public:
+        static const size_t MAX_SIZE = UINT32_MAX;
+
+        SourceFile(const std::string& path);
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        std::string_view getContent() const;
+};
+
+#endif
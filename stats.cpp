@@ -0,0 +1,72 @@
+#include "stats.hpp"
+
+// Names of the token types, in the order they are declared
+static const char* token_type_names[NUM_TOKEN_TYPES] = {
+    "IDENTIFER", "INTEGER", "CHAR", "STRING", "COMMENT_1", "COMMENT_2",
+    "PROGRAM", "VAR", "CONST", "TYPE", "FUNCTION", "RETURN", "BEGIN", "END", "SWAP", "ASSIGN", "OUTPUT", "IF",
+    "THEN", "ELSE", "WHILE", "DO", "CASE", "OF", "DOTS", "OTHERWISE", "REPEAT", "FOR", "UNTIL", "LOOP", "POOL",
+    "EXIT", "LEQ", "NEQ", "GEQ", "GE", "LE", "EQ", "MOD", "AND", "OR", "NOT", "READ", "SUCC", "PRED", "CHR", "ORD", "EOFT",
+    "COLON", "SEMICOLON", "PERIOD", "COMMA", "OPENBRKT", "CLSBRKT", "PLUS", "MINUS", "MULT", "DIVIDE"
+};
+
+Stats::Stats(){
+    this->read_time = 0;
+    this->lex_time = 0;
+    this->parse_time = 0;
+    this->check_time = 0;
+    this->print_time = 0;
+    for (int i=0; i<NUM_TOKEN_TYPES; ++i){
+        this->token_counts[i] = 0;
+    }
+    this->comments_stripped = 0;
+    this->nodes_allocated = 0;
+    this->bytes_allocated = 0;
+    this->symbols = 0;
+    this->max_stack_depth = 0;
+    this->max_statement_depth = 0;
+    this->max_expression_depth = 0;
+    this->cache_hits = 0;
+    this->cache_misses = 0;
+}
+
+double Stats::secondsSince(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Writes the report as a single JSON object
+void Stats::printJson(std::ostream& out){
+    size_t total_tokens = 0;
+    for (int i=0; i<NUM_TOKEN_TYPES; ++i){
+        total_tokens += token_counts[i];
+    }
+
+    out << "{\"time_seconds\": {"
+        << "\"read\": " << read_time
+        << ", \"lex\": " << lex_time
+        << ", \"parse\": " << parse_time
+        << ", \"check\": " << check_time
+        << ", \"print\": " << print_time
+        << "}, \"tokens\": " << total_tokens
+        << ", \"tokens_by_type\": {";
+
+    bool first = true;
+    for (int i=0; i<NUM_TOKEN_TYPES; ++i){
+        if (token_counts[i] == 0){
+            continue;
+        }
+        out << (first ? "" : ", ") << "\"" << token_type_names[i] << "\": " << token_counts[i];
+        first = false;
+    }
+
+    out << "}, \"comments_stripped\": " << comments_stripped
+        << ", \"nodes_allocated\": " << nodes_allocated
+        << ", \"bytes_allocated\": " << bytes_allocated
+        << ", \"symbols\": " << symbols
+        << ", \"max_stack_depth\": " << max_stack_depth
+        << ", \"max_statement_depth\": " << max_statement_depth
+        << ", \"max_expression_depth\": " << max_expression_depth
+        << ", \"cache_hits\": " << cache_hits
+        << ", \"cache_misses\": " << cache_misses
+        << "}\n";
+}
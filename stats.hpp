@@ -0,0 +1,39 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <ostream>
+#include <cstddef>
+#include <chrono>
+#include "token.hpp"
+
+// Timings and counters collected over a run, reported by the --stats option
+class Stats {
+
+    public:
+        // Wall times of each phase, in seconds
+        double read_time;
+        double lex_time;
+        double parse_time;
+        double check_time;
+        double print_time;
+
+        size_t token_counts[NUM_TOKEN_TYPES];
+        size_t comments_stripped;
+
+        size_t nodes_allocated;
+        size_t bytes_allocated;
+        size_t symbols;
+        size_t max_stack_depth;
+        int max_statement_depth;
+        int max_expression_depth;
+
+        size_t cache_hits;
+        size_t cache_misses;
+
+        Stats();
+        void printJson(std::ostream& out);
+
+        static double secondsSince(std::chrono::steady_clock::time_point start);
+};
+
+#endif
@@ -1,10 +1,10 @@
 #include "token.hpp"
 #include <cctype>
-#include <unordered_set>
 #include <stdexcept>
+#include <cstring>
 #include "iostream"
 
-std::map <TokenType, std::string> Token::predefined_tokens = {
+const std::map <TokenType, std::string> Token::predefined_tokens = {
     {TokenType::PROGRAM, "program"}, 
     {TokenType::VAR, "var"},
     {TokenType::CONST, "const"},
@@ -59,34 +59,58 @@ std::map <TokenType, std::string> Token::predefined_tokens = {
     {TokenType::DIVIDE, "/"}
 };
 
-Token::Token(TokenType type, std::string value) {
+Token::Token(TokenType type, std::string_view value) {
     this->type = type;
-    this->value = value;
+    this->text = value.data();
+    this->length = value.size();
 }
 
+// Token types whose value depends on the source, rather than being fixed
+static constexpr TokenSet not_predefined = {
+    TokenType::IDENTIFER, 
+    TokenType::INTEGER, 
+    TokenType::CHAR, 
+    TokenType::COMMENT_1, 
+    TokenType::COMMENT_2
+};
+
 Token::Token(TokenType type){
-    std::unordered_set<TokenType> not_predefined = {
-        TokenType::IDENTIFER, 
-        TokenType::INTEGER, 
-        TokenType::CHAR, 
-        TokenType::COMMENT_1, 
-        TokenType::COMMENT_2
-    };
-    if (not_predefined.count(type)){
+    if (not_predefined.contains(type)){
         throw std::runtime_error("String argument required to construct non-predefined token");
     }
     else {
+        const std::string& value = predefined_tokens.at(type);
         this->type = type;
-        this->value = predefined_tokens[type];
+        this->text = value.data();
+        this->length = value.size();
+    }
+}
+
+// Describes a token type for error messages, eg- "'begin'" or "identifier"
+std::string Token::describe(TokenType type){
+    switch (type){
+        case TokenType::IDENTIFER:
+            return "identifier";
+        case TokenType::INTEGER:
+            return "integer";
+        case TokenType::CHAR:
+            return "char";
+        case TokenType::STRING:
+            return "string";
+        case TokenType::COMMENT_1:
+        case TokenType::COMMENT_2:
+            return "comment";
+        default:
+            return "'" + predefined_tokens.at(type) + "'";
     }
 }
 
-TokenType Token::getType(){
+TokenType Token::getType() const {
     return type;
 }
 
-std::string Token::getValue(){
-    return value;
+std::string_view Token::getValue() const {
+    return std::string_view(text, length);
 }
 
 TokenType Token::identifyNonPredefinedTokenType(char c){
@@ -111,4 +135,131 @@ TokenType Token::identifyNonPredefinedTokenType(char c){
     }
     throw std::runtime_error("Unexpected character ("+
                             std::string(1,c) + ") encountered: token could not be identified.\n");
+}
+
+// Compares a run of characters in the source against a keyword, without building a string
+static bool keywordIs(const char* text, int length, const char* keyword){
+    return (int) strlen(keyword) == length && memcmp(text, keyword, length) == 0;
+}
+
+// Identifies whether a complete alphabetic run of characters is a keyword.
+// Dispatches on the first letter so that only a handful of keywords are compared.
+// Returns true and sets type if it is a keyword.
+bool Token::identifyKeyword(const char* text, int length, TokenType& type){
+
+    switch (text[0]){
+        case 'a':
+            if (keywordIs(text, length, "and"))         { type = TokenType::AND; return true; }
+            break;
+        case 'b':
+            if (keywordIs(text, length, "begin"))       { type = TokenType::BEGIN; return true; }
+            break;
+        case 'c':
+            if (keywordIs(text, length, "const"))       { type = TokenType::CONST; return true; }
+            if (keywordIs(text, length, "case"))        { type = TokenType::CASE; return true; }
+            if (keywordIs(text, length, "chr"))         { type = TokenType::CHR; return true; }
+            break;
+        case 'd':
+            if (keywordIs(text, length, "do"))          { type = TokenType::DO; return true; }
+            break;
+        case 'e':
+            if (keywordIs(text, length, "end"))         { type = TokenType::END; return true; }
+            if (keywordIs(text, length, "else"))        { type = TokenType::ELSE; return true; }
+            if (keywordIs(text, length, "exit"))        { type = TokenType::EXIT; return true; }
+            if (keywordIs(text, length, "eof"))         { type = TokenType::EOFT; return true; }
+            break;
+        case 'f':
+            if (keywordIs(text, length, "function"))    { type = TokenType::FUNCTION; return true; }
+            if (keywordIs(text, length, "for"))         { type = TokenType::FOR; return true; }
+            break;
+        case 'i':
+            if (keywordIs(text, length, "if"))          { type = TokenType::IF; return true; }
+            break;
+        case 'l':
+            if (keywordIs(text, length, "loop"))        { type = TokenType::LOOP; return true; }
+            break;
+        case 'm':
+            if (keywordIs(text, length, "mod"))         { type = TokenType::MOD; return true; }
+            break;
+        case 'n':
+            if (keywordIs(text, length, "not"))         { type = TokenType::NOT; return true; }
+            break;
+        case 'o':
+            if (keywordIs(text, length, "output"))      { type = TokenType::OUTPUT; return true; }
+            if (keywordIs(text, length, "of"))          { type = TokenType::OF; return true; }
+            if (keywordIs(text, length, "otherwise"))   { type = TokenType::OTHERWISE; return true; }
+            if (keywordIs(text, length, "or"))          { type = TokenType::OR; return true; }
+            if (keywordIs(text, length, "ord"))         { type = TokenType::ORD; return true; }
+            break;
+        case 'p':
+            if (keywordIs(text, length, "program"))     { type = TokenType::PROGRAM; return true; }
+            if (keywordIs(text, length, "pool"))        { type = TokenType::POOL; return true; }
+            if (keywordIs(text, length, "pred"))        { type = TokenType::PRED; return true; }
+            break;
+        case 'r':
+            if (keywordIs(text, length, "return"))      { type = TokenType::RETURN; return true; }
+            if (keywordIs(text, length, "repeat"))      { type = TokenType::REPEAT; return true; }
+            if (keywordIs(text, length, "read"))        { type = TokenType::READ; return true; }
+            break;
+        case 's':
+            if (keywordIs(text, length, "succ"))        { type = TokenType::SUCC; return true; }
+            break;
+        case 't':
+            if (keywordIs(text, length, "type"))        { type = TokenType::TYPE; return true; }
+            if (keywordIs(text, length, "then"))        { type = TokenType::THEN; return true; }
+            break;
+        case 'u':
+            if (keywordIs(text, length, "until"))       { type = TokenType::UNTIL; return true; }
+            break;
+        case 'v':
+            if (keywordIs(text, length, "var"))         { type = TokenType::VAR; return true; }
+            break;
+        case 'w':
+            if (keywordIs(text, length, "while"))       { type = TokenType::WHILE; return true; }
+            break;
+        default:
+            break;
+    }
+    return false;
+}
+
+// Identifies the longest operator / punctuation token at the start of text (eg- ":=:" over ":=" over ":").
+// remaining is the number of characters left in the source, and an operator is only matched
+// if at least one character follows it.
+// Returns the length of the operator and sets type, or returns 0 if there is none.
+int Token::identifyOperator(const char* text, int remaining, TokenType& type){
+
+    switch (text[0]){
+        case ':':
+            if (remaining > 3 && text[1] == '=' && text[2] == ':') { type = TokenType::SWAP; return 3; }
+            if (remaining > 2 && text[1] == '=')                   { type = TokenType::ASSIGN; return 2; }
+            type = TokenType::COLON;
+            break;
+        case '.':
+            if (remaining > 2 && text[1] == '.') { type = TokenType::DOTS; return 2; }
+            type = TokenType::PERIOD;
+            break;
+        case '<':
+            if (remaining > 2 && text[1] == '=') { type = TokenType::LEQ; return 2; }
+            if (remaining > 2 && text[1] == '>') { type = TokenType::NEQ; return 2; }
+            type = TokenType::LE;
+            break;
+        case '>':
+            if (remaining > 2 && text[1] == '=') { type = TokenType::GEQ; return 2; }
+            type = TokenType::GE;
+            break;
+        case '=': type = TokenType::EQ; break;
+        case ';': type = TokenType::SEMICOLON; break;
+        case ',': type = TokenType::COMMA; break;
+        case '(': type = TokenType::OPENBRKT; break;
+        case ')': type = TokenType::CLSBRKT; break;
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::MULT; break;
+        case '/': type = TokenType::DIVIDE; break;
+        default:
+            return 0;
+    }
+    // Single character operators
+    return (remaining > 1) ? 1 : 0;
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 #define TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <map>
+#include <cstdint>
+#include <initializer_list>
 
 enum class TokenType {
     // define all the types of tokens that will be used.
@@ -15,20 +18,63 @@ enum class TokenType {
     COLON, SEMICOLON, PERIOD, COMMA, OPENBRKT, CLSBRKT, PLUS, MINUS, MULT, DIVIDE
 };
 
+// Number of token types, DIVIDE being the last
+const int NUM_TOKEN_TYPES = static_cast<int>(TokenType::DIVIDE) + 1;
+
+// Set of token types, held as one bit per type so that sets can be built at compile time
+// and membership is a single mask test
+class TokenSet {
+    private:
+        uint64_t bits;
+
+        constexpr TokenSet(uint64_t bits) : bits(bits) { }
+
+        static constexpr uint64_t bit(TokenType type){
+            return uint64_t(1) << static_cast<int>(type);
+        }
+
+    public:
+        constexpr TokenSet() : bits(0) { }
+
+        constexpr TokenSet(std::initializer_list<TokenType> types) : bits(0) {
+            for (TokenType type: types){
+                bits |= bit(type);
+            }
+        }
+
+        constexpr bool contains(TokenType type) const {
+            return (bits & bit(type)) != 0;
+        }
+
+        constexpr TokenSet operator|(TokenSet other) const {
+            return TokenSet(bits | other.bits);
+        }
+};
+
+static_assert(NUM_TOKEN_TYPES <= 64, "TokenSet holds at most 64 token types");
+
+// A token does not own its value - it refers to a span of the source buffer given to the Lexer
+// (or to the spelling in predefined_tokens, for tokens not read from a source), so the source must outlive the token.
+// Its position is where the value points into the source (see Lexer::getOffset), so it takes no space of its own.
 class Token {
     private:
+        const char* text;
+        uint32_t length;
         TokenType type;
-        std::string value;
 
     public:
-        static std::map<TokenType, std::string> predefined_tokens;
+        // Read-only after static initialization, so it can be shared between threads
+        static const std::map<TokenType, std::string> predefined_tokens;
 
         Token(TokenType type);
-        Token(TokenType type, std::string value);
+        Token(TokenType type, std::string_view value);
         static TokenType identifyNonPredefinedTokenType(char c);
+        static std::string describe(TokenType type);
+        static bool identifyKeyword(const char* text, int length, TokenType& type);
+        static int identifyOperator(const char* text, int remaining, TokenType& type);
 
-        TokenType getType();
-        std::string getValue();
+        TokenType getType() const;
+        std::string_view getValue() const;
 };
 
 #endif
\ No newline at end of file
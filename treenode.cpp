@@ -1,6 +1,8 @@
 #include "treenode.hpp"
+#include <new>
+#include <cstdint>
 
-std::unordered_map<TreeNodeType, std::string> TreeNode::type_string_map = {
+const std::unordered_map<TreeNodeType, std::string> TreeNode::type_string_map = {
     {TreeNodeType::IDENTIFER, "<identifier>"}, 
     {TreeNodeType::INTEGER, "<integer>"}, 
     {TreeNodeType::CHAR, "<char>"},
@@ -57,35 +59,171 @@ std::unordered_map<TreeNodeType, std::string> TreeNode::type_string_map = {
     {TreeNodeType::ORD, "ord"}
 };
 
-TreeNode::TreeNode(std::string value){
-    this->value=value;
+// Leaf nodes refer to the token's value in the source buffer, which must outlive the tree
+TreeNode::TreeNode(std::string_view value, uint32_t symbol){
+    this->value = value.data();
+    this->value_length = value.size();
+    this->symbol = symbol;
+    this->children = nullptr;
+    this->num_children = 0;
+    this->start = 0;
+    this->end = 0;
 }
 
 
 TreeNode::TreeNode(TreeNodeType type){
+    // The label is a view of the type's entry in type_string_map, which is never copied
+    std::string_view label = type_string_map.at(type);
     this->type = type;
-    this->value = type_string_map[type];
+    this->value = label.data();
+    this->value_length = label.size();
+    this->symbol = Interner::NO_SYMBOL;
+    this->children = nullptr;
+    this->num_children = 0;
+    this->start = 0;
+    this->end = 0;
 }
 
-void TreeNode::addChild(TreeNode* child){
-    this->children.push_back(child);
+// Returns the label printed for nodes of the given type
+std::string_view TreeNode::typeString(TreeNodeType type){
+    return type_string_map.at(type);
 }
 
-std::string TreeNode::pprintTree(int depth){
-    std::string printStr = "";
-    for (int i=0; i<depth; ++i){
-        printStr.append(". ");
+// The child array is not copied - it should be allocated from the same arena as the node
+void TreeNode::setChildren(TreeNode** children, int num_children){
+    this->children = children;
+    this->num_children = num_children;
+}
+
+TreeNodeType TreeNode::getType(){
+    return type;
+}
+
+// Returns the token value of a value leaf, or the type label of any other node
+std::string_view TreeNode::getValue(){
+    return std::string_view(value, value_length);
+}
+
+uint32_t TreeNode::getSymbol(){
+    return symbol;
+}
+
+void TreeNode::setSymbol(uint32_t symbol){
+    this->symbol = symbol;
+}
+
+TreeNode** TreeNode::getChildren(){
+    return children;
+}
+
+int TreeNode::getNumChildren(){
+    return num_children;
+}
+
+void TreeNode::setSpan(uint32_t start, uint32_t end){
+    this->start = start;
+    this->end = end;
+}
+
+uint32_t TreeNode::getStart(){
+    return start;
+}
+
+uint32_t TreeNode::getEnd(){
+    return end;
+}
+
+// Writes the tree to the stream one line per node, each indented by ". " per level of depth.
+// Walks the tree with an explicit stack, so deep trees neither recurse nor get built up in memory.
+void TreeNode::pprintTree(std::ostream& out){
+    std::vector<std::pair<TreeNode*, int>> pending = { {this, 0} };
+    std::string indent = "";
+    bool first = true;
+
+    while (!pending.empty()){
+        TreeNode* node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        while ((int) indent.size() < 2*depth){
+            indent.append(". ");
+        }
+        if (!first){
+            out << "\n";
+        }
+        first = false;
+        out.write(indent.data(), 2*depth);
+        out.write(node->value, node->value_length);
+        out << "(" << node->num_children << ")";
+
+        // Push the children last to first, so that the first child is printed next
+        for (int i=node->num_children-1; i>=0; --i){
+            pending.push_back({node->children[i], depth+1});
+        }
     }
-    int n = this->children.size();
+}
 
-    printStr.append(this->value);
-    printStr.append("(");
-    printStr.append(std::to_string(n));
-    printStr.append(")");
+TreeArena::TreeArena(){
+    this->current = nullptr;
+    this->remaining = 0;
+    this->node_count = 0;
+    this->bytes_allocated = 0;
+}
 
-    for (int i=0; i<n; ++i){
-        printStr.append("\n");
-        printStr.append(this->children[i]->pprintTree(depth+1));
+TreeArena::~TreeArena(){
+    // TreeNodes hold no resources of their own, so the blocks are freed without visiting the nodes
+    for (char* block: blocks){
+        delete[] block;
     }
-    return printStr;
+}
+
+void* TreeArena::allocate(size_t size, size_t align){
+    size_t padding = (align - reinterpret_cast<uintptr_t>(current) % align) % align;
+
+    if (current == nullptr || padding + size > remaining){
+        // Oversized requests (eg- very long child lists) get a block of their own
+        size_t new_block_size = (size + align > block_size) ? size + align : block_size;
+        char* block = new char[new_block_size];
+        blocks.push_back(block);
+        bytes_allocated += new_block_size;
+        current = block;
+        remaining = new_block_size;
+        padding = (align - reinterpret_cast<uintptr_t>(current) % align) % align;
+    }
+
+    void* result = current + padding;
+    current += padding + size;
+    remaining -= padding + size;
+    return result;
+}
+
+TreeNode* TreeArena::newNode(std::string_view value, uint32_t symbol){
+    node_count++;
+    return new (allocate(sizeof(TreeNode), alignof(TreeNode))) TreeNode(value, symbol);
+}
+
+TreeNode* TreeArena::newNode(TreeNodeType type){
+    node_count++;
+    return new (allocate(sizeof(TreeNode), alignof(TreeNode))) TreeNode(type);
+}
+
+TreeNode** TreeArena::newChildren(int num_children){
+    if (num_children == 0){
+        return nullptr;
+    }
+    return static_cast<TreeNode**>(allocate(num_children * sizeof(TreeNode*), alignof(TreeNode*)));
+}
+
+size_t TreeArena::getNodeCount(){
+    return node_count;
+}
+
+// Returns the total size of the blocks allocated by the arena
+size_t TreeArena::getBytesAllocated(){
+    return bytes_allocated;
+}
+
+// Returns the symbols of the values of the trees built in this arena
+Interner& TreeArena::getSymbols(){
+    return symbols;
 }
\ No newline at end of file
@@ -1,6 +1,13 @@
+#ifndef TREENODE_H
+#define TREENODE_H
+
 #include <vector>
 #include <string>
+#include <string_view>
+#include <ostream>
+#include <cstdint>
 #include <unordered_map>
+#include "intern.hpp"
 
 enum class TreeNodeType {
     IDENTIFER, INTEGER, CHAR, STRING,
@@ -11,19 +18,77 @@ enum class TreeNodeType {
     PRED, CHR, ORD
 };
 
+// Number of tree node types, ORD being the last
+const int NUM_TREE_NODE_TYPES = static_cast<int>(TreeNodeType::ORD) + 1;
+
 class TreeNode {
 
     private:
-        static std::unordered_map<TreeNodeType, std::string> type_string_map;
+        // Read-only after static initialization, so it can be shared between threads
+        static const std::unordered_map<TreeNodeType, std::string> type_string_map;
 
+        // Ordered (and the value split into pointer and length) so that the span and symbol fit 
+        // into what would otherwise be padding, keeping a node at 40 bytes
         TreeNodeType type;
-        std::string value;
-        std::vector<TreeNode*> children;
+        int num_children;
+        // Byte offsets in the source of the first and one past the last character the node covers
+        uint32_t start;
+        uint32_t end;
+        const char* value;
+        uint32_t value_length;
+        // Symbol of the token value, for a value leaf and the node above it. NO_SYMBOL for other nodes
+        uint32_t symbol;
+        TreeNode** children;
 
     public:
-        TreeNode(std::string value);
+        TreeNode(std::string_view value, uint32_t symbol);
         TreeNode(TreeNodeType type);
-        void addChild(TreeNode* child);
+        static std::string_view typeString(TreeNodeType type);
+        void setChildren(TreeNode** children, int num_children);
+        TreeNodeType getType();
+        std::string_view getValue();
+        uint32_t getSymbol();
+        void setSymbol(uint32_t symbol);
+        TreeNode** getChildren();
+        int getNumChildren();
+        void setSpan(uint32_t start, uint32_t end);
+        uint32_t getStart();
+        uint32_t getEnd();
+
+        void pprintTree(std::ostream& out);
+};
+
+// Bump allocator which owns every TreeNode (and child array) of a tree, and the symbols of its values.
+// Nodes are never freed individually - all of them are released together when the arena is destroyed,
+// so the arena must outlive any tree built in it.
+class TreeArena {
+
+    private:
+        static const size_t block_size = 64 * 1024;
+
+        std::vector<char*> blocks;
+        char* current;
+        size_t remaining;
+        size_t node_count;
+        size_t bytes_allocated;
+        Interner symbols;
+
+        void* allocate(size_t size, size_t align);
+
+    public:
+        TreeArena();
+        ~TreeArena();
+
+        TreeArena(const TreeArena&) = delete;
+        TreeArena& operator=(const TreeArena&) = delete;
+
+        TreeNode* newNode(std::string_view value, uint32_t symbol);
+        TreeNode* newNode(TreeNodeType type);
+        TreeNode** newChildren(int num_children);
+
+        size_t getNodeCount();
+        size_t getBytesAllocated();
+        Interner& getSymbols();
+};
 
-        std::string pprintTree(int depth);
-};
\ No newline at end of file
+#endif
\ No newline at end of file
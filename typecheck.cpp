@@ -0,0 +1,486 @@
+#include "typecheck.hpp"
+#include <algorithm>
+
+// Names of the predefined types, by TypeId
+static const char* const PREDEFINED_TYPE_NAMES[] = {"no type", "an unknown type", "integer", "char", "boolean"};
+
+TypeChecker::TypeChecker(const FlatTree& tree, Lexer& lexer, SemanticAnalyzer& names)
+    : tree(tree), lexer(lexer), names(names) {
+    this->types = {
+        TypeInfo{Declaration::NO_NODE, 0},
+        TypeInfo{Declaration::NO_NODE, 0},
+        TypeInfo{Declaration::NO_NODE, 0},
+        TypeInfo{Declaration::NO_NODE, 256},
+        TypeInfo{Declaration::NO_NODE, 2}
+    };
+    this->declaration_types = { };
+    this->functions = { };
+    this->node_types = { };
+    this->problems = { };
+    this->diagnostics = { };
+}
+
+// Returns whether the node is an <identifier>, rather than the value leaf below one
+bool TypeChecker::isName(uint32_t node){
+    return tree.getNode(node).type == TreeNodeType::IDENTIFER && tree.getNode(node).num_children == 1;
+}
+
+std::string TypeChecker::nameOf(uint32_t node){
+    return std::string(tree.getLabel(node + 1));
+}
+
+void TypeChecker::report(uint32_t node, const std::string& message){
+    problems.push_back(Problem{tree.getNode(node).source_start, message});
+}
+
+// Returns the declaration an <identifier> node is bound to, or null if its name was not resolved
+const Declaration* TypeChecker::declarationOf(uint32_t node){
+    uint32_t declaration = names.getBinding(node);
+    if (declaration == SemanticAnalyzer::NO_DECLARATION){
+        return nullptr;
+    }
+    return &names.getDeclaration(declaration);
+}
+
+// Returns the function whose "fcn" node this is, or null if it was not declared (being a partial tree).
+// Functions are in the order of their nodes
+const TypeChecker::FunctionInfo* TypeChecker::functionAt(uint32_t fcn){
+    auto it = std::lower_bound(functions.begin(), functions.end(), fcn, [](const FunctionInfo& f, uint32_t node){
+        return f.begin < node;
+    });
+    if (it == functions.end() || it->begin != fcn){
+        return nullptr;
+    }
+    return &*it;
+}
+
+// Returns the type a type name (of a var, param or function result) denotes
+TypeId TypeChecker::typeNamed(uint32_t type_name){
+    const Declaration* declaration = declarationOf(type_name);
+    if (!declaration){
+        return ERROR_TYPE;
+    }
+    if (declaration->kind != DeclarationKind::TYPE){
+        report(type_name, "'" + nameOf(type_name) + "' is not a type");
+        return ERROR_TYPE;
+    }
+    return declaration_types[names.getBinding(type_name)];
+}
+
+// Predefined names have no node, and are told apart by name
+void TypeChecker::declarePredefined(){
+    for (uint32_t d=0; d<names.getNumDeclarations(); ++d){
+        const Declaration& declaration = names.getDeclaration(d);
+        if (declaration.node != Declaration::NO_NODE){
+            continue;
+        }
+        std::string_view name = tree.getSymbols().getName(declaration.symbol);
+        if (name == "integer" || name == "d"){
+            declaration_types[d] = INTEGER_TYPE;
+        }
+        else if (name == "char"){
+            declaration_types[d] = CHAR_TYPE;
+        }
+        else if (name == "boolean" || name == "true" || name == "false"){
+            declaration_types[d] = BOOLEAN_TYPE;
+        }
+    }
+}
+
+// Const -> Name ConstValue ; the const is of the type of its value
+void TypeChecker::declareConst(uint32_t c){
+    uint32_t name = c + 1;
+    uint32_t value = tree.getNode(name).end;
+    TypeId type = ERROR_TYPE;
+    switch (tree.getNode(value).type){
+        case TreeNodeType::INTEGER:
+            type = INTEGER_TYPE;
+            break;
+        case TreeNodeType::CHAR:
+            type = CHAR_TYPE;
+            break;
+        default:
+            if (const Declaration* declaration = declarationOf(value)){
+                if (declaration->kind == DeclarationKind::CONSTANT || declaration->kind == DeclarationKind::LITERAL){
+                    type = declaration_types[names.getBinding(value)];
+                }
+                else {
+                    report(value, "'" + nameOf(value) + "' is not a constant");
+                }
+            }
+            break;
+    }
+    if (names.getBinding(name) != SemanticAnalyzer::NO_DECLARATION){
+        declaration_types[names.getBinding(name)] = type;
+    }
+}
+
+// Type -> Name LitList ; a new enumerated type, whose literals are its values in order
+void TypeChecker::declareType(uint32_t t){
+    uint32_t name = t + 1;
+    uint32_t lit = tree.getNode(name).end;
+    TypeId type = types.size();
+    types.push_back(TypeInfo{name, tree.getNode(lit).num_children});
+
+    if (names.getBinding(name) != SemanticAnalyzer::NO_DECLARATION){
+        declaration_types[names.getBinding(name)] = type;
+    }
+    for (uint32_t l=lit+1; l<tree.getNode(lit).end; l=tree.getNode(l).end){
+        if (names.getBinding(l) != SemanticAnalyzer::NO_DECLARATION){
+            declaration_types[names.getBinding(l)] = type;
+        }
+    }
+}
+
+// Dcln -> Name+ TypeName ; a var or param
+void TypeChecker::declareVars(uint32_t var){
+    uint32_t type_name = var + 1;
+    for (uint32_t n=var+1; n<tree.getNode(var).end; n=tree.getNode(n).end){
+        type_name = n;
+    }
+    TypeId type = typeNamed(type_name);
+    for (uint32_t n=var+1; n<type_name; n=tree.getNode(n).end){
+        if (names.getBinding(n) != SemanticAnalyzer::NO_DECLARATION){
+            declaration_types[names.getBinding(n)] = type;
+        }
+    }
+}
+
+// Fcn -> Name Params TypeName Consts Types Dclns Body Name ; a function is of the type it returns
+void TypeChecker::declareFunction(uint32_t fcn){
+    if (tree.getNode(fcn).num_children != FUNCTION_PARTS){
+        return;
+    }
+    uint32_t name = fcn + 1;
+    uint32_t result = tree.getNode(tree.getNode(name).end).end;
+    TypeId type = typeNamed(result);
+    if (names.getBinding(name) != SemanticAnalyzer::NO_DECLARATION){
+        declaration_types[names.getBinding(name)] = type;
+    }
+    functions.push_back(FunctionInfo{fcn, tree.getNode(fcn).end, type, { }});
+}
+
+// Collects the types of a function's params, in order, once they have been declared
+void TypeChecker::declareParams(FunctionInfo& function){
+    uint32_t params = tree.getNode(function.begin + 1).end;
+    for (uint32_t v=params+1; v<tree.getNode(params).end; v=tree.getNode(v).end){
+        if (tree.getNode(v).type != TreeNodeType::VAR){
+            continue;
+        }
+        for (uint32_t n=v+1; tree.getNode(n).end<tree.getNode(v).end; n=tree.getNode(n).end){
+            uint32_t declaration = names.getBinding(n);
+            function.params.push_back(declaration == SemanticAnalyzer::NO_DECLARATION ? ERROR_TYPE : declaration_types[declaration]);
+        }
+    }
+}
+
+// Returns whether values of the type can be stepped by adding or subtracting an integer
+bool TypeChecker::isSteppable(TypeId type){
+    return type == CHAR_TYPE || type > BOOLEAN_TYPE;
+}
+
+// Returns the type of a node used as a value. A type name is not one
+TypeId TypeChecker::valueOf(uint32_t node){
+    TypeId type = node_types[node];
+    if (type == NO_TYPE){
+        if (isName(node)){
+            report(node, "'" + nameOf(node) + "' is not a value");
+        }
+        return ERROR_TYPE;
+    }
+    return type;
+}
+
+// Reports a value which is not of the expected type, unless either is unknown.
+// Returns whether the value is of the type, which an unknown type may be
+bool TypeChecker::expect(uint32_t node, TypeId expected){
+    TypeId type = valueOf(node);
+    if (type != expected && type != ERROR_TYPE && expected != ERROR_TYPE){
+        report(node, "Expected " + getTypeName(expected) + ", got " + getTypeName(type));
+        return false;
+    }
+    return true;
+}
+
+// Returns whether a name can be assigned (or read) to, as vars and params can. So can a function's name,
+// which sets what it returns
+bool TypeChecker::isAssignable(uint32_t name){
+    const Declaration* declaration = declarationOf(name);
+    if (!declaration){
+        return false;
+    }
+    if (declaration->kind != DeclarationKind::VARIABLE && declaration->kind != DeclarationKind::PARAMETER
+        && declaration->kind != DeclarationKind::FUNCTION){
+        report(name, "Cannot assign to '" + nameOf(name) + "'");
+        return false;
+    }
+    return true;
+}
+
+// Checks a node whose children have all been checked, and returns its type.
+// An operator with an operand of the wrong type is of ERROR_TYPE, so that what uses it is not reported too.
+// The function is the one the node is in, null for the program's body
+TypeId TypeChecker::checkNode(uint32_t node, const FunctionInfo* function){
+    const FlatNode& n = tree.getNode(node);
+    uint32_t first = node + 1;
+    switch (n.type){
+        case TreeNodeType::IDENTIFER: {
+            if (!isName(node)){
+                return NO_TYPE;
+            }
+            const Declaration* declaration = declarationOf(node);
+            if (!declaration){
+                return ERROR_TYPE;
+            }
+            if (declaration->kind == DeclarationKind::TYPE){
+                return NO_TYPE;
+            }
+            return declaration_types[names.getBinding(node)];
+        }
+        case TreeNodeType::INTEGER:
+            return n.num_children == 1 ? INTEGER_TYPE : NO_TYPE;
+        case TreeNodeType::CHAR:
+            return n.num_children == 1 ? CHAR_TYPE : NO_TYPE;
+        case TreeNodeType::TRUE:
+        case TreeNodeType::EOFT:
+            return BOOLEAN_TYPE;
+
+        // Relational operators compare any two values of the same type
+        case TreeNodeType::LEQ:
+        case TreeNodeType::LE:
+        case TreeNodeType::GEQ:
+        case TreeNodeType::GE:
+        case TreeNodeType::EQ:
+        case TreeNodeType::NEQ: {
+            TypeId left = valueOf(first);
+            TypeId right = valueOf(tree.getNode(first).end);
+            if (left != right && left != ERROR_TYPE && right != ERROR_TYPE){
+                report(node, "Cannot compare " + getTypeName(left) + " with " + getTypeName(right));
+            }
+            return BOOLEAN_TYPE;
+        }
+        // An enumerated value or char may be stepped by an integer, as the reference programs do with
+        // "n:=n+1". It keeps its type, as with succ and pred, which step it by one
+        case TreeNodeType::PLUS:
+        case TreeNodeType::MINUS:
+            if (n.num_children == 2){
+                TypeId left = node_types[first];
+                TypeId right = node_types[tree.getNode(first).end];
+                if (isSteppable(left) && right == INTEGER_TYPE){
+                    return left;
+                }
+                if (n.type == TreeNodeType::PLUS && left == INTEGER_TYPE && isSteppable(right)){
+                    return right;
+                }
+            }
+            [[fallthrough]];
+        case TreeNodeType::MULT:
+        case TreeNodeType::DIVIDE:
+        case TreeNodeType::MOD: {
+            bool valid = true;
+            for (uint32_t c=first; c<n.end; c=tree.getNode(c).end){
+                valid &= expect(c, INTEGER_TYPE);
+            }
+            return valid ? INTEGER_TYPE : ERROR_TYPE;
+        }
+        case TreeNodeType::OR:
+        case TreeNodeType::AND:
+        case TreeNodeType::NOT: {
+            bool valid = true;
+            for (uint32_t c=first; c<n.end; c=tree.getNode(c).end){
+                valid &= expect(c, BOOLEAN_TYPE);
+            }
+            return valid ? BOOLEAN_TYPE : ERROR_TYPE;
+        }
+
+        // Every type is ordinal
+        case TreeNodeType::SUCC:
+        case TreeNodeType::PRED:
+            return valueOf(first);
+        case TreeNodeType::CHR:
+            return expect(first, INTEGER_TYPE) ? CHAR_TYPE : ERROR_TYPE;
+        case TreeNodeType::ORD:
+            valueOf(first);
+            return INTEGER_TYPE;
+
+        // Call -> Name Expression+ ; a wrong number of arguments has been reported already
+        case TreeNodeType::CALL: {
+            const Declaration* declaration = declarationOf(first);
+            const FunctionInfo* callee = nullptr;
+            if (declaration && declaration->kind == DeclarationKind::FUNCTION){
+                callee = functionAt(declaration->node - 1);
+            }
+            if (!callee){
+                return ERROR_TYPE;
+            }
+            size_t i = 0;
+            for (uint32_t c=tree.getNode(first).end; c<n.end; c=tree.getNode(c).end, ++i){
+                if (i < callee->params.size()){
+                    expect(c, callee->params[i]);
+                }
+                else {
+                    valueOf(c);
+                }
+            }
+            return callee->result;
+        }
+
+        case TreeNodeType::ASSIGN:
+            if (isAssignable(first)){
+                expect(tree.getNode(first).end, node_types[first]);
+            }
+            return NO_TYPE;
+        case TreeNodeType::SWAP: {
+            uint32_t second = tree.getNode(first).end;
+            if (isAssignable(first) && isAssignable(second)){
+                TypeId left = node_types[first];
+                TypeId right = node_types[second];
+                if (left != right && left != ERROR_TYPE && right != ERROR_TYPE){
+                    report(node, "Cannot swap " + getTypeName(left) + " with " + getTypeName(right));
+                }
+            }
+            return NO_TYPE;
+        }
+        case TreeNodeType::READ:
+            for (uint32_t c=first; c<n.end; c=tree.getNode(c).end){
+                if (isAssignable(c) && node_types[c] != INTEGER_TYPE && node_types[c] != CHAR_TYPE
+                    && node_types[c] != ERROR_TYPE){
+                    report(c, "Cannot read " + getTypeName(node_types[c]));
+                }
+            }
+            return NO_TYPE;
+        case TreeNodeType::OUTPUT:
+            for (uint32_t c=first; c<n.end; c=tree.getNode(c).end){
+                if (tree.getNode(c).type != TreeNodeType::TN_INTEGER){
+                    continue;
+                }
+                TypeId type = valueOf(c + 1);
+                if (type != INTEGER_TYPE && type != CHAR_TYPE && type != ERROR_TYPE){
+                    report(c + 1, "Cannot output " + getTypeName(type));
+                }
+            }
+            return NO_TYPE;
+
+        case TreeNodeType::IF:
+        case TreeNodeType::WHILE:
+            expect(first, BOOLEAN_TYPE);
+            return NO_TYPE;
+        case TreeNodeType::REPEAT: {
+            uint32_t condition = first;
+            for (uint32_t c=first; c<n.end; c=tree.getNode(c).end){
+                condition = c;
+            }
+            expect(condition, BOOLEAN_TYPE);
+            return NO_TYPE;
+        }
+        // For -> ForStat ForExp ForStat Statement
+        case TreeNodeType::FOR:
+            expect(tree.getNode(first).end, BOOLEAN_TYPE);
+            return NO_TYPE;
+
+        // Case -> Expression CaseClause+ Otherwise? ; each label is of the type of the expression
+        case TreeNodeType::CASE: {
+            TypeId type = valueOf(first);
+            for (uint32_t clause=tree.getNode(first).end; clause<n.end; clause=tree.getNode(clause).end){
+                if (tree.getNode(clause).type != TreeNodeType::CASECLAUSE){
+                    continue;
+                }
+                for (uint32_t c=clause+1; tree.getNode(c).end<tree.getNode(clause).end; c=tree.getNode(c).end){
+                    expect(c, type);
+                }
+            }
+            return NO_TYPE;
+        }
+        // A range of case labels is of the type of its ends
+        case TreeNodeType::DOTS: {
+            TypeId type = valueOf(first);
+            expect(tree.getNode(first).end, type);
+            return type;
+        }
+
+        case TreeNodeType::RETURN:
+            if (function){
+                expect(first, function->result);
+            }
+            return NO_TYPE;
+
+        default:
+            return NO_TYPE;
+    }
+}
+
+// Declarations come before their uses in the source, so one pass in order gives each its type.
+// The nodes are then checked in reverse, so that each operand is typed before what uses it
+void TypeChecker::check(){
+    declaration_types.assign(names.getNumDeclarations(), ERROR_TYPE);
+    node_types.assign(tree.size(), NO_TYPE);
+    declarePredefined();
+
+    for (uint32_t i=0; i<tree.size(); ++i){
+        switch (tree.getNode(i).type){
+            case TreeNodeType::CONST:
+                declareConst(i);
+                break;
+            case TreeNodeType::TYPE:
+                declareType(i);
+                break;
+            case TreeNodeType::VAR:
+                declareVars(i);
+                break;
+            case TreeNodeType::FCN:
+                declareFunction(i);
+                break;
+            default:
+                break;
+        }
+    }
+    for (FunctionInfo& function: functions){
+        declareParams(function);
+    }
+
+    size_t f = functions.size();
+    for (uint32_t i=tree.size(); i-- > 0; ){
+        while (f > 0 && functions[f-1].begin > i){
+            f--;
+        }
+        const FunctionInfo* function = (f > 0 && i < functions[f-1].end) ? &functions[f-1] : nullptr;
+        node_types[i] = checkNode(i, function);
+    }
+
+    std::stable_sort(problems.begin(), problems.end(), [](const Problem& a, const Problem& b){
+        return a.offset < b.offset;
+    });
+    for (const Problem& problem: problems){
+        diagnostics.push_back(Diagnostic{lexer.getLocation(problem.offset), problem.message});
+    }
+}
+
+const std::vector<Diagnostic>& TypeChecker::getDiagnostics(){
+    return diagnostics;
+}
+
+TypeId TypeChecker::getType(uint32_t node){
+    return node_types[node];
+}
+
+TypeId TypeChecker::getDeclarationType(uint32_t declaration){
+    return declaration_types[declaration];
+}
+
+// The name a type was declared with
+std::string TypeChecker::getTypeName(TypeId type){
+    if (types[type].node == Declaration::NO_NODE){
+        return PREDEFINED_TYPE_NAMES[type];
+    }
+    return nameOf(types[type].node);
+}
+
+// Number of values of an ordinal type, in the order of their ordinals. 0 for integer, whose values are unbounded
+uint32_t TypeChecker::getNumLiterals(TypeId type){
+    return types[type].num_literals;
+}
+
+// Number of types, including the predefined ones
+size_t TypeChecker::getNumTypes(){
+    return types.size();
+}
@@ -0,0 +1,108 @@
+#ifndef TYPECHECK_H
+#define TYPECHECK_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "flattree.hpp"
+#include "lex.hpp"
+#include "parser.hpp"
+#include "semantic.hpp"
+
+// Index of a type in a TypeChecker. The predefined types come first, then one per enumerated type
+typedef uint32_t TypeId;
+
+// Works out the type of every expression in a program whose names have been resolved, and reports
+// operands, conditions, assignments, arguments, case labels and returned values of the wrong type.
+//
+// Types are integer, char, boolean and the enumerated types declared by the program, all of them ordinal:
+// succ and pred keep the type of their operand, chr takes an integer to a char, and ord takes any
+// ordinal value to an integer. Adding an integer to an enumerated value or char (or subtracting one from it)
+// steps it as succ and pred do, keeping its type. Values of different types otherwise never mix,
+// so comparing a char with an integer, or multiplying an enumerated value, is an error.
+//
+// The type of each node is kept in a side table indexed by node, like the bindings it is built from.
+// Nodes are in pre-order, so visiting them in reverse reaches every operand before what uses it,
+// and the whole pass is a single loop over the tree, after one over its declarations.
+class TypeChecker {
+
+    private:
+        // An error found at a byte offset in the source, turned into a Diagnostic once the pass is done
+        struct Problem {
+            uint32_t offset;
+            std::string message;
+        };
+
+        struct TypeInfo {
+            uint32_t node;          // Index of the <identifier> node naming it, Declaration::NO_NODE if predefined
+            uint32_t num_literals;  // Number of values, 0 for integer
+        };
+
+        // A function's nodes, from its "fcn" node, with the types of its result and params
+        struct FunctionInfo {
+            uint32_t begin;
+            uint32_t end;
+            TypeId result;
+            std::vector<TypeId> params;
+        };
+
+        static const int FUNCTION_PARTS = 8;
+
+        const FlatTree& tree;
+        Lexer& lexer;
+        SemanticAnalyzer& names;
+
+        std::vector<TypeInfo> types;
+        std::vector<TypeId> declaration_types;
+        std::vector<FunctionInfo> functions;
+        std::vector<TypeId> node_types;
+
+        std::vector<Problem> problems;
+        std::vector<Diagnostic> diagnostics;
+
+        bool isName(uint32_t node);
+        std::string nameOf(uint32_t node);
+        void report(uint32_t node, const std::string& message);
+        const Declaration* declarationOf(uint32_t node);
+        const FunctionInfo* functionAt(uint32_t fcn);
+
+        TypeId typeNamed(uint32_t type_name);
+        void declarePredefined();
+        void declareConst(uint32_t c);
+        void declareType(uint32_t t);
+        void declareVars(uint32_t var);
+        void declareFunction(uint32_t fcn);
+        void declareParams(FunctionInfo& function);
+
+        bool isSteppable(TypeId type);
+        TypeId valueOf(uint32_t node);
+        bool expect(uint32_t node, TypeId expected);
+        bool isAssignable(uint32_t name);
+        TypeId checkNode(uint32_t node, const FunctionInfo* function);
+
+    public:
+        static constexpr TypeId NO_TYPE = 0;        // Of nodes which are not values, as statements are
+        static constexpr TypeId ERROR_TYPE = 1;     // Of values whose type is wrong or unknown, already reported
+        static constexpr TypeId INTEGER_TYPE = 2;
+        static constexpr TypeId CHAR_TYPE = 3;
+        static constexpr TypeId BOOLEAN_TYPE = 4;
+
+        // The names must have been analyzed. Names which could not be resolved are of ERROR_TYPE,
+        // so they are not reported again
+        TypeChecker(const FlatTree& tree, Lexer& lexer, SemanticAnalyzer& names);
+
+        void check();
+
+        // Errors, in the order they appear in the source
+        const std::vector<Diagnostic>& getDiagnostics();
+
+        // Type of the value of a node, NO_TYPE if it has none
+        TypeId getType(uint32_t node);
+        // Type of the value a declaration names (or of what a function returns), or the type a type name denotes
+        TypeId getDeclarationType(uint32_t declaration);
+        std::string getTypeName(TypeId type);
+        uint32_t getNumLiterals(TypeId type);
+        size_t getNumTypes();
+};
+
+#endif